@@ -1,7 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <limits.h>
 #include <windows.h>
+#include <io.h>
+#include <fcntl.h>
 #define TAM 1000000
 #define TAMANHO 1000
 
@@ -11,11 +15,14 @@
 * TOTSIM representa o total de caracteres da tabela ASCII
 * MAX representa o numero maximo de caracteres em cada linha do texto
 * MIN representa o numero minimo de caracteres em uma string
+* BITS_MAXIMOS representa o tamanho maximo de um codigo de huffman. A string usada por @see construir_tabela_codigo guarda o lado da raiz na primeira
+* posicao, depois o caminho ate a folha e por fim o terminador, sobrando MIN-2 posicoes para o codigo
 */
 
 #define TOTSIM 128
 #define MAX 10000
 #define MIN 20
+#define BITS_MAXIMOS (MIN-2)
 
 
 /**
@@ -80,29 +87,15 @@ No* criar_no ()
 /**
 * Funcao Criar Arvore de Huffman
 * @brief Funcao que gera uma arvore de huffman inicial totalmente nula e a retorna para o usuario
-* Primeiramente a funcao tenta alocar a arvore na memoria, se foi possivel aloca-la ela
+* Primeiramente a funcao tenta alocar a arvore na memoria, se foi possivel aloca-la ela cria o no cabeca e a retorna. A alocacao e feita com calloc,
+* de modo que a matriz de texto so ocupa memoria fisica nas linhas que de fato forem escritas
 */
 Huffman* criar_arvore_huffman ()
 {
-    Huffman* h = (Huffman*) malloc(sizeof(Huffman));
+    Huffman* h = (Huffman*) calloc(1, sizeof(Huffman));
     if (h!=NULL)
     {
         h->cabeca = criar_no();
-        h->caracteres = 0;
-        h->tamanho = 0;
-        h->tamanho_compressao_final = 0;
-        int i, j;
-        for (i=0; i<MAX; i++)
-        {
-            for (j=0; j<MAX; j++)
-            {
-                h->texto[i][j] = 0;
-            }
-        }
-        for (i=0; i<TOTSIM; i++)
-        {
-            h->frequencia_letras[i] = 0;
-        }
         return h;
     }
     return NULL;
@@ -111,24 +104,35 @@ Huffman* criar_arvore_huffman ()
 * Funcao Frequencia de Texto na Arvore
 * @brief
 * A funcao que recebe a arvore @param h e o arquivo @param arq e com isso
+* Os caracteres que a tabela nao representa, isto e, o caractere nulo e os de fora da tabela ASCII, sao ignorados. Uma linha com MAX-1 caracteres
+* ou mais continua na linha seguinte da matriz, de modo que toda linha termina com o caractere nulo. Retorna 1 caso todos os caracteres do arquivo
+* sejam representaveis e caibam na matriz e 0 caso contrario, quando o arquivo nao deve ser comprimido
 */
-void frequencia_texto_arvore (Huffman* h, FILE* arq)
+int frequencia_texto_arvore (Huffman* h, FILE* arq)
 {
-    int i = 0, j = 0, k = 0;
+    int i = 0, j = 0, k = 0, representavel = 1;
 
-    while (!feof(arq))
+    while ((k = fgetc(arq)) != EOF)
     {
-        k = fgetc(arq);
+        if (k == 0 || k >= TOTSIM)
+        {
+            representavel = 0;
+            continue;
+        }
+        if (i == MAX)
+        {
+            return 0;
+        }
         h->texto[i][j] = k;
         h->frequencia_letras[k]++;
         j++;
-        if (k == '\n')
+        if (k == '\n' || j == MAX-1)
         {
             i++;
             j = 0;
         }
     }
-    h->texto[i][j-1] = 0;
+    return representavel;
 }
 /**
 * Funcao Quantidade de Caracteres
@@ -276,6 +280,54 @@ void montar_arvore_huffman (Huffman* h)
     }
 }
 /**
+* Funcao Liberar Nos
+* @brief Funcao que devolve a memoria de um no e de todos os nos alcancaveis a partir dele
+* Percorre recursivamente os filhos esquerdo e direito e a lista encadeada de proximos, de modo que serve tanto para a lista de nos folhas
+* quanto para a arvore ja montada por @see montar_arvore_huffman
+*/
+void liberar_nos (No* no)
+{
+    if (no != NULL)
+    {
+        liberar_nos(no->filhoesq);
+        liberar_nos(no->filhodir);
+        liberar_nos(no->proximo);
+        free(no);
+    }
+}
+/**
+* Funcao Reiniciar Arvore de Huffman
+* @brief Funcao que devolve a arvore @param h ao estado inicial para que ela seja reaproveitada na compressao de outro arquivo
+* Libera os nos da arvore anterior e zera as frequencias e contadores. Da matriz de texto apenas as linhas efetivamente escritas por
+* @see frequencia_texto_arvore sao zeradas, evitando percorrer os 100 MB da matriz a cada arquivo
+*/
+void reiniciar_arvore_huffman (Huffman* h)
+{
+    int i;
+    liberar_nos(h->cabeca->proximo);
+    h->cabeca->proximo = NULL;
+    for (i=0; i<MAX && h->texto[i][0]!=0; i++)
+    {
+        memset(h->texto[i], 0, strnlen(h->texto[i], MAX));
+    }
+    memset(h->frequencia_letras, 0, sizeof(h->frequencia_letras));
+    h->caracteres = 0;
+    h->tamanho = 0;
+    h->tamanho_compressao_final = 0;
+}
+/**
+* Funcao Liberar Arvore de Huffman
+* @brief Funcao que devolve toda a memoria ocupada pela arvore @param h, incluindo o no cabeca
+*/
+void liberar_arvore_huffman (Huffman* h)
+{
+    if (h != NULL)
+    {
+        liberar_nos(h->cabeca);
+        free(h);
+    }
+}
+/**
 * Funo Caminho
 * @brief Funo que gera a codificao de cada letra
 * Funcao que recebe como parametros um no @param no, um vetor de caracteres @param str, um inteiro @param i e um caractere @param c, que sao utilizados para gerar
@@ -332,19 +384,6 @@ void zerar_palavra(char* str)
     }
 }
 /**
-* Funo Zerar Carateres
-* @brief Funcao que preenche com zeros a string que contem os bits do arquivo
-* Como cada byte pode ser espresso por 8 bits, essa funcao preenche um vetor de 1 byte com zeros  
-*/
-void zerar_caractere(char str[])
-{
-    int i;
-    for (i=0; i<9; i++)
-    {
-        str[i] = 0;
-    }
-}
-/**
 * Funo Construir o Codigo da Tabela
 * @brief Funcao que gera o codigo que ira ser inserido na tabela para posterior uso de codificacao e decodificacao
 *	Dada a entrada de uma rvore de huffman @param h e uma matriz de caracteres @param tabela[][MIN]  posivel gerar uma codificacao para ser reaproveitada posteriormente
@@ -370,87 +409,170 @@ void construir_tabela_codigo (Huffman* h, char tabela[][MIN])
     }
 }
 /**
-* Funo Gerar Codigo
-* @brief Funcao que transforma 8 bits de dados em 1 byte 
-* Atraves dessa funcao torna-se possivel comprimir os dados, pois a mesma transforma os 8 bits da string codificada em um unico byte que  obtido pela transformacao
-* dos 8 bits em decimal e a conversao desse numero decimal em um char da tabela ASCII
+* Struct Codigo de Huffman
+* @brief Consiste no codigo de um caractere ja convertido de string de '0's e '1's para bits, pronto para o codificador
 */
-unsigned char gerar_codigo(char s_aux[])
+typedef struct CodigoHuffman
 {
-    unsigned char s = 0;
-    if(s_aux[0] == '1')
-      s += 128;
-    if(s_aux[1] == '1') 
-      s += 64;
-    if(s_aux[2] == '1') 
-      s += 32;
-    if(s_aux[3] == '1')
-      s += 16;
-    if(s_aux[4] == '1') 
-      s += 8;
-    if(s_aux[5] == '1')
-      s += 4;
-    if(s_aux[6] == '1') 
-      s += 2;
-    if(s_aux[7] == '1') 
-      s += 1;
+    unsigned long long bits; /**< Bits do codigo alinhados a esquerda, isto e, o primeiro bit do codigo e o bit mais significativo*/
+    int tamanho; /**< Quantidade de bits do codigo, zero para os caracteres ausentes da tabela*/
+} CodigoHuffman;
 
-    return s;
-}
 /**
-* Funcao Imprimir Codificado
-* @brief Le cada caractere armazenado na matriz de texto, e busca uma codificacao correspondente ao caractere lido e a imprime no texto
-* Antes de comecar a impressao no arquivo, um vetor e criado. Este contera a sequencia binaria final correspondente a todos os caracteres lidos do texto. 
-* Logo apos, esta sequencia de 0's e 1's e dividida em grupos de 8 bits (1 byte). Cara grupo de 8 bits correspondera a um novo simbolo da tabela ASCII, os quais serao impressos no arquivo comprimido
-* Desta forma, alem de diminuir os 8 bits fixos utilizados para representar cada letra do texto, o produto final de bits ainda e divido por oito para evitar que cada bit seja impresso como byte, prejudicando a compressao do algoritmo.
+* Struct Escritor de Bits
+* @brief Consiste no estado do codificador: um acumulador de 64 bits e a posicao de escrita no vetor de saida
 */
-void imprimir_codificado(Huffman* h, FILE* arq, char tabela[][MIN])
+typedef struct EscritorBits
 {
-    int i = 0, j = 0, k, indice=0, total = 0;
-    char cadeia_aux[9];
-    unsigned char cadeia_aux2[TAM];
-    cadeia_aux[8] = 0;
-    unsigned char caractere;
-    qtd_caracteres(h);
-    for (i=0; h->texto[i][j]!=0; i++)
+    unsigned long long acumulador; /**< Bits ainda nao escritos, alinhados a esquerda*/
+    int bits; /**< Quantidade de bits validos no acumulador, sempre menor que 8 entre chamadas de @see codificar_simbolos*/
+    unsigned char* saida; /**< Proxima posicao de escrita do vetor de saida*/
+} EscritorBits;
+
+/**
+* Defines do Codificador
+* SIMBOLOS_POR_PASSO representa quantos caracteres sao acrescentados ao acumulador antes de cada descarga. Como os codigos tem no maximo BITS_MAXIMOS bits
+* e sobram no maximo 7 bits da descarga anterior, 3 codigos sempre cabem nos 64 bits do acumulador
+* INVERTER_BYTES_64 coloca o byte mais significativo do acumulador no primeiro endereco, ja que a gravacao e feita em uma maquina little-endian
+*/
+#define SIMBOLOS_POR_PASSO 3
+#if defined(_MSC_VER)
+#define INVERTER_BYTES_64(x) _byteswap_uint64(x)
+#else
+#define INVERTER_BYTES_64(x) __builtin_bswap64(x)
+#endif
+
+/**
+* Funcao Montar Codigos
+* @brief Converte a tabela de codigo @param tabela, de strings de '0's e '1's, para os 256 codigos em bits de @param codigos
+* Os caracteres fora da tabela ASCII ou sem codigo recebem tamanho zero
+*/
+void montar_codigos (char tabela[][MIN], CodigoHuffman codigos[256])
+{
+    int i, k;
+    for (i=0; i<256; i++)
     {
-        for (j=0; h->texto[i][j]!=0; j++)
+        codigos[i].bits = 0;
+        codigos[i].tamanho = 0;
+        if (i < TOTSIM)
         {
-            h->tamanho_compressao_final += strlen(tabela[h->texto[i][j]]);
-            for (k=0; tabela[h->texto[i][j]][k]!=0; k++)
+            for (k=0; tabela[i][k]!=0; k++)
             {
-                cadeia_aux[indice] = tabela[h->texto[i][j]][k];
-                if(indice == 7)
-                {
-                    caractere = gerar_codigo(cadeia_aux);
-                    cadeia_aux2[total] = caractere;
-                    total++;
-                    zerar_caractere(cadeia_aux);
-                    indice = 0;
-                }
-                else
+                if (tabela[i][k] == '1')
                 {
-                    indice++;
+                    codigos[i].bits |= 1ULL << (63-k);
                 }
             }
+            codigos[i].tamanho = k;
         }
-        j=0;
     }
-    caractere = '\n';
+}
+/**
+* Funcao Iniciar Escritor
+* @brief Prepara o escritor @param e para gravar a partir do inicio do vetor @param saida
+* O vetor deve ter 8 bytes de folga apos o ultimo byte codificado, pois cada descarga grava 8 bytes de uma vez
+*/
+void iniciar_escritor (EscritorBits* e, unsigned char* saida)
+{
+    e->acumulador = 0;
+    e->bits = 0;
+    e->saida = saida;
+}
+/**
+* Funcao Descarregar Bits
+* @brief Grava os bytes completos do acumulador @param acumulador a partir de @param saida e retorna a posicao seguinte ao ultimo byte completo
+* A gravacao e uma unica copia desalinhada de 8 bytes, e os bits que nao completam um byte ficam no acumulador, com a sua quantidade em
+* @param bits. O deslocamento do acumulador e dividido em dois para que um deslocamento de 64 bits, indefinido em C, nunca ocorra
+*/
+static __inline unsigned char* descarregar_bits (unsigned char* saida, unsigned long long* acumulador, int* bits)
+{
+    unsigned long long bytes = INVERTER_BYTES_64(*acumulador);
+    int descarga = *bits >> 3;
+    memcpy(saida, &bytes, 8);
+    *acumulador <<= descarga << 2;
+    *acumulador <<= descarga << 2;
+    *bits &= 7;
+    return saida + descarga;
+}
+/**
+* Funcao Codificar Simbolos
+* @brief Acrescenta ao escritor @param e os codigos dos @param n caracteres de @param simbolos
+* A cada passo os codigos de SIMBOLOS_POR_PASSO caracteres sao unidos no acumulador sem nenhum desvio condicional, e os bytes completos sao
+* descarregados com uma unica gravacao desalinhada de 8 bytes (@see descarregar_bits)
+*/
+void codificar_simbolos (EscritorBits* e, const unsigned char* simbolos, int n, const CodigoHuffman codigos[256])
+{
+    unsigned long long acumulador = e->acumulador;
+    unsigned char* saida = e->saida;
+    int bits = e->bits, i = 0;
+    const CodigoHuffman* c;
+    for (; i+SIMBOLOS_POR_PASSO <= n; i+=SIMBOLOS_POR_PASSO)
+    {
+        const CodigoHuffman* c0 = &codigos[simbolos[i]];
+        const CodigoHuffman* c1 = &codigos[simbolos[i+1]];
+        const CodigoHuffman* c2 = &codigos[simbolos[i+2]];
+        int t01 = c0->tamanho + c1->tamanho;
+        unsigned long long passo = c0->bits | (c1->bits >> c0->tamanho) | (c2->bits >> t01);
+        acumulador |= passo >> bits;
+        bits += t01 + c2->tamanho;
+        saida = descarregar_bits(saida, &acumulador, &bits);
+    }
+    for (; i<n; i++)
+    {
+        c = &codigos[simbolos[i]];
+        acumulador |= c->bits >> bits;
+        bits += c->tamanho;
+        saida = descarregar_bits(saida, &acumulador, &bits);
+    }
+    e->acumulador = acumulador;
+    e->bits = bits;
+    e->saida = saida;
+}
+/**
+* Funcao Imprimir Codificado
+* @brief Le cada caractere armazenado na matriz de texto, e busca uma codificacao correspondente ao caractere lido e a imprime no texto
+* A tabela de codigo e convertida para bits (@see montar_codigos) e cada linha do texto e codificada por @see codificar_simbolos em um vetor
+* de bytes. O tamanho final da compressao vem do produto das frequencias pelos tamanhos dos codigos, o que permite alocar o vetor de saida
+* com o tamanho exato antes da codificacao, ja que @see frequencia_texto_arvore conta exatamente os caracteres guardados nas linhas. Os bytes
+* completos sao impressos de uma unica vez e os bits que nao completam um byte sao impressos como caracteres '0' e '1', formato esperado por
+* @see gerar_binario
+*/
+void imprimir_codificado(Huffman* h, FILE* arq, char tabela[][MIN])
+{
+    int i, total;
+    long long bits_total = 0;
     char outro[20];
+    unsigned char* cadeia_aux2;
+    CodigoHuffman codigos[256];
+    EscritorBits escritor;
+    montar_codigos(tabela, codigos);
+    qtd_caracteres(h);
+    for (i=0; i<TOTSIM; i++)
+    {
+        bits_total += (long long) h->frequencia_letras[i] * codigos[i].tamanho;
+    }
+    h->tamanho_compressao_final = (float) bits_total;
+    cadeia_aux2 = (unsigned char*) malloc(bits_total/8 + 8);
+    if (cadeia_aux2 == NULL)
+    {
+        puts("Memoria insuficiente!");
+        exit(1);
+    }
+    iniciar_escritor(&escritor, cadeia_aux2);
+    for (i=0; i<MAX && h->texto[i][0]!=0; i++)
+    {
+        codificar_simbolos(&escritor, (unsigned char*) h->texto[i], (int) strnlen(h->texto[i], MAX), codigos);
+    }
+    total = (int) (escritor.saida - cadeia_aux2);
     sprintf(outro, "%d", total);
-    fwrite(&outro,sizeof(char),strlen(outro),arq);
-    fwrite(&caractere,sizeof(char),1,arq);
-    for(i=0; i<total; i++)
-        fwrite(&cadeia_aux2[i],sizeof(unsigned char),1,arq);
-
-    if(indice != 0)
+    fwrite(outro, sizeof(char), strlen(outro), arq);
+    fwrite("\n", sizeof(char), 1, arq);
+    fwrite(cadeia_aux2, sizeof(unsigned char), total, arq);
+    for (i=0; i<escritor.bits; i++)
     {
-        i=0;
-        for (i=0; cadeia_aux[i]!=0; i++)
-            fwrite(&cadeia_aux[i],sizeof(char),1,arq);
+        fputc((escritor.acumulador >> (63-i)) & 1 ? '1' : '0', arq);
     }
-
+    free(cadeia_aux2);
 }
 /**
 * Funo Imprimir o Codigo da Tabela
@@ -491,6 +613,68 @@ void zerar_tabela(char tabela[][MIN])
     }
 }
 /**
+* Funcao Altura da Arvore
+* @brief Retorna a quantidade de arestas do caminho mais longo entre o no @param no e uma folha, isto e, o tamanho do maior codigo da arvore
+*/
+int altura_arvore (No* no)
+{
+    int esq, dir;
+    if (no == NULL || (no->filhoesq == NULL && no->filhodir == NULL))
+    {
+        return 0;
+    }
+    esq = altura_arvore(no->filhoesq);
+    dir = altura_arvore(no->filhodir);
+    return 1 + (esq > dir ? esq : dir);
+}
+/**
+* Funcao Montar Tabela Limitada
+* @brief Monta na arvore @param h a arvore de huffman das frequencias @param frequencias e a tabela de codigo @param tabela correspondente,
+* com codigos de no maximo @param max_bits bits, que nao pode passar de BITS_MAXIMOS
+* Segue o mesmo caminho da compressao de um arquivo (@see criar_nos_folhas, @see montar_arvore_huffman e @see construir_tabela_codigo). Enquanto
+* a arvore for alta demais, as frequencias sao divididas por dois, sem que nenhuma se anule, e a arvore e montada novamente. A arvore fica em
+* @param h para ser percorrida na decodificacao
+*/
+void montar_tabela_limitada (Huffman* h, const int frequencias[], char tabela[][MIN], int max_bits)
+{
+    int i;
+    memcpy(h->frequencia_letras, frequencias, sizeof(h->frequencia_letras));
+    while (1)
+    {
+        liberar_nos(h->cabeca->proximo);
+        h->cabeca->proximo = NULL;
+        h->tamanho = 0;
+        criar_nos_folhas(h);
+        montar_arvore_huffman(h);
+        if (altura_arvore(h->cabeca->proximo) <= max_bits)
+        {
+            break;
+        }
+        for (i=0; i<TOTSIM; i++)
+        {
+            if (h->frequencia_letras[i] > 0)
+            {
+                h->frequencia_letras[i] = (h->frequencia_letras[i] + 1) / 2;
+            }
+        }
+    }
+    zerar_tabela(tabela);
+    construir_tabela_codigo(h, tabela);
+}
+/**
+* Funcao Montar Tabela do Arquivo
+* @brief Monta em @param h a arvore e em @param tabela a tabela de codigo das frequencias ja contadas em @param h, com codigos de no maximo
+* BITS_MAXIMOS bits (@see montar_tabela_limitada)
+* As frequencias contadas sao restauradas ao final, ja que @see imprimir_codificado as usa para calcular o tamanho da saida
+*/
+void montar_tabela_arquivo (Huffman* h, char tabela[][MIN])
+{
+    int frequencias[TOTSIM];
+    memcpy(frequencias, h->frequencia_letras, sizeof(frequencias));
+    montar_tabela_limitada(h, frequencias, tabela, BITS_MAXIMOS);
+    memcpy(h->frequencia_letras, frequencias, sizeof(frequencias));
+}
+/**
 * Funcao Imprimir Tabela
 * @brief Imprime a tabela de codigo construida a partir do algoritmo de Huffman
 * Utilizada apenas no desenvolvimento parcial do trabalho, com o intuito de concluir se a tabela de codigo gerada pelo programa era a correta
@@ -508,6 +692,112 @@ void imprimir_tabela(char tabela[][MIN])
     }
 }
 /**
+* Funcao Ler Tabela de Codigo
+* @brief Le do arquivo comprimido @param arq a tabela de codigo gravada por @see imprimir_tabela_codigo
+* Cada linha da tabela e guardada com o caractere, o seu codigo e a quebra de linha final, formato esperado por @see verifica_string. Uma quebra
+* de linha so e lida como caractere da tabela no inicio da primeira linha, ja que um texto sem quebras de linha nao a tem na tabela. A leitura
+* termina na linha vazia que separa a tabela do restante do arquivo
+*/
+void ler_tabela_codigo (FILE* arq, char tabela[][MIN])
+{
+    int i = 0, j = 0;
+    char caractere, caractere_antigo = 0;
+    int okay = 1;
+    while(fread(&caractere,sizeof(char),1,arq) == 1)
+    {
+        if (caractere_antigo == '\n' && caractere == '\n')
+        {
+            break;
+        }
+        if(caractere == '\n' && okay == 1 && j == 0)
+        {
+            tabela[i][j] = caractere;
+            j++;
+            okay = 0;
+        }
+        else if(caractere == '\n')
+        {
+            tabela[i][j] = caractere;
+            i++;
+            j = 0;
+        }
+        else
+        {
+            tabela[i][j] = caractere;
+            j++;
+        }
+        caractere_antigo = caractere;
+    }
+}
+/**
+* Funcao Ler Linha
+* @brief Le do arquivo @param arq os caracteres ate a proxima quebra de linha, guardando no maximo @param tamanho - 1 deles em @param str
+*/
+void ler_linha (FILE* arq, char str[], int tamanho)
+{
+    int i = 0, c;
+    while ((c = fgetc(arq)) != EOF && c != '\n')
+    {
+        if (i < tamanho-1)
+        {
+            str[i] = (char) c;
+            i++;
+        }
+    }
+    str[i] = 0;
+}
+/**
+* Tabela do CRC-32
+* Resto da divisao polinomial de cada byte pelo polinomio 0xEDB88320, preenchido por @see iniciar_crc32 antes do uso de @see atualizar_crc32
+*/
+unsigned long tabela_crc32[256];
+/**
+* Funcao Iniciar CRC-32
+* @brief Preenche a tabela do CRC-32. Deve ser chamada uma unica vez, antes da criacao de qualquer thread
+*/
+void iniciar_crc32 ()
+{
+    unsigned long c;
+    int i, k;
+    for (i=0; i<256; i++)
+    {
+        c = (unsigned long) i;
+        for (k=0; k<8; k++)
+        {
+            c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+        }
+        tabela_crc32[i] = c;
+    }
+}
+/**
+* Funcao Atualizar CRC-32
+* @brief Retorna o CRC-32 de @param crc estendido pelos @param n bytes de @param dados. O CRC de uma sequencia vazia e zero
+*/
+unsigned long atualizar_crc32 (unsigned long crc, const unsigned char* dados, size_t n)
+{
+    size_t i;
+    crc = ~crc & 0xFFFFFFFFUL;
+    for (i=0; i<n; i++)
+    {
+        crc = tabela_crc32[(crc ^ dados[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc & 0xFFFFFFFFUL;
+}
+/**
+* Funcao CRC-32 do Texto
+* @brief Retorna o CRC-32 do texto lido para a arvore @param h por @see frequencia_texto_arvore
+*/
+unsigned long crc32_texto (Huffman* h)
+{
+    int i;
+    unsigned long crc = 0;
+    for (i=0; i<MAX && h->texto[i][0]!=0; i++)
+    {
+        crc = atualizar_crc32(crc, (unsigned char*) h->texto[i], strnlen(h->texto[i], MAX));
+    }
+    return crc;
+}
+/**
 * Funcao Limpa Auxiliar
 * @brief Preenche todas as posicoes de uma dada string com caractere nulo
 * E utilizada na funcao @see decodificacao para eliminar o risco de que algum caractere de uma palavra anterior esteja presente na analise dos caracteres da palavra atual
@@ -549,15 +839,15 @@ char verifica_string(char str[], char tabela[][MIN] )
     return 0;
 }
 /**
-* Funcao Decodificacao
-* @brief Converte o vetor codificacao binario para uma sequencia de caracteres correspondentes aos grupos de 8 bits 
-* Apos a funcao @see gera_binario ter lido e convertido os caracteres do arquivo comprimido para a sequencia binaria, a funcao atual e chamada para converter a sequencia binaria em caracteres comuns a fim de restaurar o arquivo original
+* Funcao Escrever Decodificado
+* @brief Converte o vetor codificacao binario @param codificacao em caracteres, escrevendo-os no arquivo ja aberto @param arq
+* Retorna o CRC-32 dos caracteres escritos (@see atualizar_crc32), utilizado para conferir a integridade dos membros de um arquivo de varios membros
 */
-void decodificacao(char tabela[][MIN], char codificacao[TAM], char nome_original[])
+unsigned long escrever_decodificado(FILE* arq, char tabela[][MIN], char codificacao[])
 {
-    FILE * arq3 = fopen(nome_original, "w");
     int i = 0, j=0;
     char string_auxiliar[MIN], caractere;
+    unsigned long crc = 0;
     limpa_auxiliar(string_auxiliar);
     for(i = 0; codificacao[i] != 0; i++)
     {
@@ -565,8 +855,8 @@ void decodificacao(char tabela[][MIN], char codificacao[TAM], char nome_original
         caractere = verifica_string(string_auxiliar, tabela);
         if (caractere != 0)
         {
-            //putchar(caractere);
-            fprintf(arq3,"%c", caractere);
+            fputc(caractere, arq);
+            crc = atualizar_crc32(crc, (unsigned char*) &caractere, 1);
             limpa_auxiliar(string_auxiliar);
             j = 0;
         }
@@ -575,6 +865,18 @@ void decodificacao(char tabela[][MIN], char codificacao[TAM], char nome_original
             j++;
         }
     }
+    return crc;
+}
+/**
+* Funcao Decodificacao
+* @brief Converte o vetor codificacao binario para uma sequencia de caracteres correspondentes aos grupos de 8 bits 
+* Apos a funcao @see gera_binario ter lido e convertido os caracteres do arquivo comprimido para a sequencia binaria, a funcao atual e chamada para converter a sequencia binaria em caracteres comuns a fim de restaurar o arquivo original
+* O arquivo e criado em modo binario, assim como a entrada e lida em @see comprimir_arquivo, de modo que o resultado seja identico byte a byte ao original
+*/
+void decodificacao(char tabela[][MIN], char codificacao[TAM], char nome_original[])
+{
+    FILE * arq3 = fopen(nome_original, "wb");
+    escrever_decodificado(arq3, tabela, codificacao);
     fclose(arq3);
 }
 /**
@@ -634,23 +936,23 @@ void dec_bin (int num, char vetor[])
 * Funcao Gerar Binario
 * @brief Converte cada caractere impresso no arquivo comprimido para a codificacao binaria correspondente ao seu numero na tabela ASCII 
 * Os numeros binarios correspondentes a cada caractere sao colocados na sequencia em que aparecem num vetor maior. Este sera usado na decodificacao e restauracao do arquivo original
+* No maximo @param limite bytes sao lidos do arquivo, o que permite decodificar um membro de um arquivo de varios membros; um limite negativo le ate o fim do arquivo
 */
-void gerar_binario (FILE* arq, char codificacao[], int tamanho)
+void gerar_binario (FILE* arq, char codificacao[], int tamanho, long limite)
 {
     int i=0, j=0, total = 0;
     char vetor[9], c;
     unsigned char caractere;
-    while (!feof(arq))
+    while (limite != 0 && fread(&caractere,sizeof(unsigned char),1,arq) == 1)
     {
         if(total >= tamanho)
         {
-            fread(&c,sizeof(char),1,arq);
+            c = (char) caractere;
             codificacao[i] = c;
             i++;
         }
         else
         {
-            fread(&caractere,sizeof(unsigned char),1,arq);
             dec_bin((int) caractere, vetor);
             for (j=0; vetor[j]!=0; j++)
             {
@@ -664,144 +966,2875 @@ void gerar_binario (FILE* arq, char codificacao[], int tamanho)
             }
             total++;
         }
+        if (limite > 0)
+        {
+            limite--;
+        }
     }
     codificacao[i]=0;
 }
+
 /**
-* Funcao Principal do Codigo 
-* Primeiramente, verifica-se o numero de argumentos de entrada para assim decidir se o codigo entrar na funcao de codificacao, caso hajam tres argumentos
-* e decodificacao, caso hajam dois argumentos, apos isso o algoritmo comeca a executar diversas funcoes em que para a codificacao imprime em um arquivo a 
-* tabela, o codigo codificado e o nome original e na decodificacao recupera esses dados e os aplica para gerar um novo arquivo com o nome do arquivo original
-* e com o conteudo original
+* Defines das Estatisticas
+* INTERVALO_ESTATISTICAS representa, em milissegundos, o intervalo entre duas gravacoes do arquivo de estatisticas
+* FAIXAS_LATENCIA representa a quantidade de faixas dos histogramas de latencia: a faixa 0 conta as operacoes de menos de 1 microssegundo, a
+* faixa k as de 2^(k-1) a 2^k-1 microssegundos e a ultima tambem todas as mais longas
+* ETAPA_LEITURA, ETAPA_CODIFICACAO e ETAPA_ESCRITA representam as etapas do pipeline do modo fluxo e ETAPA_ARQUIVO cada arquivo do modo lote
+* FILA_LIVRES, FILA_CHEIOS e FILA_PRONTOS representam as filas do pipeline do modo fluxo
 */
-int main (int argc, char* argv[])
+#define INTERVALO_ESTATISTICAS 1000
+#define FAIXAS_LATENCIA 24
+#define ETAPA_LEITURA 0
+#define ETAPA_CODIFICACAO 1
+#define ETAPA_ESCRITA 2
+#define ETAPA_ARQUIVO 3
+#define ETAPAS 4
+#define FILA_LIVRES 0
+#define FILA_CHEIOS 1
+#define FILA_PRONTOS 2
+#define FILAS 3
+
+/**
+* Struct Estatisticas
+* @brief Consiste nos contadores de uma execucao dos modos lote e fluxo, atualizados de forma atomica pelas threads de trabalho e gravados
+* periodicamente em um arquivo por uma thread propria (@see gravar_estatisticas)
+*/
+typedef struct Estatisticas
 {
+    const char* caminho; /**< Arquivo de estatisticas, reescrito a cada INTERVALO_ESTATISTICAS milissegundos*/
+    LONGLONG frequencia; /**< Frequencia do relogio de alta resolucao, em contagens por segundo*/
+    LONGLONG inicio; /**< Instante do inicio da execucao*/
+    volatile LONGLONG bytes_lidos; /**< Bytes lidos das entradas*/
+    volatile LONGLONG bytes_gravados; /**< Bytes gravados nas saidas*/
+    volatile LONG blocos; /**< Blocos do fluxo processados pela etapa de codificacao*/
+    volatile LONG tabelas_montadas; /**< Tabelas de codigo montadas para codificar ou restaurar*/
+    volatile LONG registros_crus; /**< Registros do fluxo gravados ou lidos sem compressao*/
+    volatile LONG arquivos; /**< Arquivos do lote comprimidos*/
+    volatile LONG falhas; /**< Arquivos do lote que nao puderam ser comprimidos*/
+    volatile LONG arquivos_pendentes; /**< Arquivos do lote ainda nao entregues a uma thread*/
+    volatile LONG filas[FILAS]; /**< Quantidade atual de blocos em cada fila do pipeline*/
+    volatile LONG picos[FILAS]; /**< Maior quantidade de blocos ja vista em cada fila do pipeline*/
+    volatile LONG latencias[ETAPAS][FAIXAS_LATENCIA]; /**< Histograma da duracao de cada operacao, por etapa*/
+    HANDLE parar; /**< Evento que encerra a thread de gravacao*/
+    HANDLE thread; /**< Thread de gravacao*/
+} Estatisticas;
 
+/**
+* Funcao Relogio
+* @brief Retorna o instante atual do relogio de alta resolucao, em contagens de QueryPerformanceFrequency
+*/
+LONGLONG relogio ()
+{
+    LARGE_INTEGER agora;
+    QueryPerformanceCounter(&agora);
+    return agora.QuadPart;
+}
+/**
+* Funcao Registrar Latencia
+* @brief Conta, no histograma da etapa @param etapa, uma operacao iniciada no instante @param inicio (@see relogio) e terminada agora
+* Assim como as demais funcoes de registro, nao faz nada caso @param s seja NULL, isto e, caso as estatisticas estejam desligadas
+*/
+void registrar_latencia (Estatisticas* s, int etapa, LONGLONG inicio)
+{
+    LONGLONG microssegundos;
+    int faixa = 0;
+    if (s == NULL)
+    {
+        return;
+    }
+    microssegundos = (relogio() - inicio) * 1000000 / s->frequencia;
+    while (microssegundos > 0 && faixa < FAIXAS_LATENCIA-1)
+    {
+        microssegundos >>= 1;
+        faixa++;
+    }
+    InterlockedIncrement(&s->latencias[etapa][faixa]);
+}
+/**
+* Funcao Somar Bytes
+* @brief Acrescenta @param lidos bytes lidos e @param gravados bytes gravados aos totais de @param s
+*/
+void somar_bytes (Estatisticas* s, LONGLONG lidos, LONGLONG gravados)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    InterlockedExchangeAdd64(&s->bytes_lidos, lidos);
+    InterlockedExchangeAdd64(&s->bytes_gravados, gravados);
+}
+/**
+* Funcao Somar Contadores
+* @brief Acrescenta @param blocos blocos, @param tabelas tabelas montadas e @param crus registros crus aos totais de @param s
+*/
+void somar_contadores (Estatisticas* s, LONG blocos, LONG tabelas, LONG crus)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    InterlockedExchangeAdd(&s->blocos, blocos);
+    InterlockedExchangeAdd(&s->tabelas_montadas, tabelas);
+    InterlockedExchangeAdd(&s->registros_crus, crus);
+}
+/**
+* Funcao Registrar Fila
+* @brief Guarda @param quantidade como a quantidade atual de blocos da fila @param fila, atualizando o pico dela
+* Deve ser chamada dentro da secao critica da fila, de modo que cada fila tem um unico escritor por vez
+*/
+void registrar_fila (Estatisticas* s, int fila, int quantidade)
+{
+    if (s == NULL)
+    {
+        return;
+    }
+    InterlockedExchange(&s->filas[fila], quantidade);
+    if (quantidade > s->picos[fila])
+    {
+        InterlockedExchange(&s->picos[fila], quantidade);
+    }
+}
+/**
+* Funcao Gravar Estatisticas
+* @brief Grava os contadores de @param s no arquivo de estatisticas, uma linha "nome valor" por contador
+* O arquivo e gravado primeiro em um arquivo temporario e entao movido sobre o anterior, de modo que quem o le nunca encontra uma gravacao
+* pela metade. Os histogramas de latencia trazem, na mesma linha, a contagem de cada faixa (@see FAIXAS_LATENCIA)
+*/
+void gravar_estatisticas (Estatisticas* s)
+{
+    static const char* etapas[ETAPAS] = {"leitura", "codificacao", "escrita", "arquivo"};
+    static const char* filas[FILAS] = {"livres", "cheios", "prontos"};
+    char temporario[2*MAX_PATH];
+    LONGLONG milissegundos = (relogio() - s->inicio) * 1000 / s->frequencia;
     FILE* arq;
-    FILE* arq_comprimido;
-    Huffman* huffman;
-    char tabela[TOTSIM][MIN];
-    zerar_tabela(tabela);
-	int inicio, fim;
-    if (argc>1 && argc<4)
+    int i, k;
+    sprintf(temporario, "%s.tmp", s->caminho);
+    arq = fopen(temporario, "w");
+    if (arq == NULL)
     {
-        if (argc==3)
-        {
-            arq = fopen(argv[1], "r");
-        }
-        else if (argc==2)
-        {
-            arq = fopen(argv[1],"rb");
-        }
-        else
+        return;
+    }
+    fprintf(arq, "tempo_ms %lld\n", (long long) milissegundos);
+    fprintf(arq, "bytes_lidos %lld\n", (long long) s->bytes_lidos);
+    fprintf(arq, "bytes_gravados %lld\n", (long long) s->bytes_gravados);
+    fprintf(arq, "vazao_kb_s %.1f\n", milissegundos > 0 ? (double) s->bytes_lidos / milissegundos * 1000 / 1024 : 0.0);
+    fprintf(arq, "blocos %ld\n", (long) s->blocos);
+    fprintf(arq, "tabelas_montadas %ld\n", (long) s->tabelas_montadas);
+    fprintf(arq, "registros_crus %ld\n", (long) s->registros_crus);
+    fprintf(arq, "arquivos %ld\n", (long) s->arquivos);
+    fprintf(arq, "falhas %ld\n", (long) s->falhas);
+    fprintf(arq, "arquivos_pendentes %ld\n", (long) s->arquivos_pendentes);
+    for (i=0; i<FILAS; i++)
+    {
+        fprintf(arq, "fila_%s %ld %ld\n", filas[i], (long) s->filas[i], (long) s->picos[i]);
+    }
+    for (i=0; i<ETAPAS; i++)
+    {
+        fprintf(arq, "latencia_%s_us", etapas[i]);
+        for (k=0; k<FAIXAS_LATENCIA; k++)
         {
-            puts("Argumentos invalidos!");
-            return 0;
+            fprintf(arq, " %ld", (long) s->latencias[i][k]);
         }
-        if(argc == 3)
-        {
-            int i,j;
-            zerar_tabela(tabela);
-
-            if (arq!=NULL)
-            {
-				inicio = GetTickCount();
-                huffman = criar_arvore_huffman();
-                frequencia_texto_arvore(huffman, arq);
-                criar_nos_folhas(huffman);
-                montar_arvore_huffman(huffman);
-                construir_tabela_codigo(huffman, tabela);
-                arq_comprimido = fopen(argv[2], "wb");
-                imprimir_tabela_codigo(arq_comprimido, tabela);
-                fwrite("\n", sizeof(char),1,arq_comprimido);
-                i = strlen(argv[1]);
-                fwrite (argv[1] , sizeof(char), i, arq_comprimido);
-                fwrite("\n", sizeof(char),1,arq_comprimido);
-                imprimir_codificado(huffman, arq_comprimido, tabela);
-				fim = GetTickCount();
-                printf("Porcentagem de compactacao %.2f\n", (float) (1-(huffman->tamanho_compressao_final/(huffman->caracteres*8)))*100);
-				printf("Tempo computacional: %d\n", fim-inicio);
-            }
-            else
-            {
-                puts("Arquivo nao encontrado!");
-                return 0;
-            }
-
-            fclose(arq);
-            fclose(arq_comprimido);
+        fprintf(arq, "\n");
+    }
+    fclose(arq);
+    MoveFileExA(temporario, s->caminho, MOVEFILE_REPLACE_EXISTING);
+}
+/**
+* Funcao Gravar Estatisticas Periodicamente
+* @brief Corpo da thread que reescreve o arquivo de estatisticas a cada INTERVALO_ESTATISTICAS milissegundos ate que o evento de parada
+* seja sinalizado, gravando-o uma ultima vez com os totais finais
+*/
+DWORD WINAPI gravar_estatisticas_periodicamente (LPVOID parametro)
+{
+    Estatisticas* s = (Estatisticas*) parametro;
+    while (WaitForSingleObject(s->parar, INTERVALO_ESTATISTICAS) == WAIT_TIMEOUT)
+    {
+        gravar_estatisticas(s);
+    }
+    gravar_estatisticas(s);
+    return 0;
+}
+/**
+* Funcao Iniciar Estatisticas
+* @brief Zera os contadores de @param s e inicia a thread que os grava periodicamente em @param caminho
+*/
+void iniciar_estatisticas (Estatisticas* s, const char* caminho)
+{
+    LARGE_INTEGER frequencia;
+    memset(s, 0, sizeof(Estatisticas));
+    QueryPerformanceFrequency(&frequencia);
+    s->caminho = caminho;
+    s->frequencia = frequencia.QuadPart;
+    s->inicio = relogio();
+    s->parar = CreateEventA(NULL, TRUE, FALSE, NULL);
+    s->thread = s->parar != NULL ? CreateThread(NULL, 0, gravar_estatisticas_periodicamente, s, 0, NULL) : NULL;
+    if (s->thread == NULL)
+    {
+        puts("Nao foi possivel criar as threads!");
+        exit(1);
+    }
+}
+/**
+* Funcao Encerrar Estatisticas
+* @brief Encerra a thread de gravacao de @param s, esperando pela ultima gravacao do arquivo
+*/
+void encerrar_estatisticas (Estatisticas* s)
+{
+    SetEvent(s->parar);
+    WaitForSingleObject(s->thread, INFINITE);
+    CloseHandle(s->thread);
+    CloseHandle(s->parar);
+}
+/**
+* Funcao Separar Estatisticas
+* @brief Retira de @param argv a opcao "-estatisticas <arquivo>", aceita logo depois do modo, e retorna o arquivo, ou NULL caso ela nao exista
+*/
+const char* separar_estatisticas (int* argc, char* argv[])
+{
+    const char* caminho;
+    int i;
+    if (*argc < 4 || strcmp(argv[2], "-estatisticas") != 0)
+    {
+        return NULL;
+    }
+    caminho = argv[3];
+    for (i=2; i+2<*argc; i++)
+    {
+        argv[i] = argv[i+2];
+    }
+    *argc -= 2;
+    argv[*argc] = NULL;
+    return caminho;
+}
+
+/**
+* Defines do Modo Lote
+* EXTENSAO_COMPRIMIDO representa a extensao acrescentada ao nome de cada arquivo comprimido pelo modo lote
+* ASSINATURA_COMPRIMIDO marca o inicio de um arquivo comprimido por @see comprimir_arquivo. Os arquivos sem ela estao no formato antigo, com a
+* tabela de codigo em linhas (@see ler_tabela_codigo)
+*/
+#define EXTENSAO_COMPRIMIDO ".huf"
+#define ASSINATURA_COMPRIMIDO "HFU1"
+
+/**
+* Defines do Arquivo de Varios Membros
+* ASSINATURA_ARQUIVO e ASSINATURA_DIRETORIO marcam, respectivamente, o inicio do arquivo e o fim do diretorio central
+* TABELA_COMPARTILHADA indica, no cabecalho e em cada entrada do diretorio, o uso da tabela de frequencias gravada logo apos o cabecalho
+* TAMANHO_CABECALHO representa o tamanho da assinatura seguida do byte de opcoes do arquivo
+* TAMANHO_RODAPE representa o tamanho do rodape: posicao do diretorio (8 bytes), quantidade de membros (4 bytes) e assinatura (4 bytes)
+* TAMANHO_ENTRADA_MINIMA representa o tamanho de uma entrada do diretorio com nome vazio (@see gravar_diretorio)
+* As tabelas do arquivo sao gravadas em binario (@see gravar_frequencias), ja que o formato em linhas de @see imprimir_tabela_codigo nao pode
+* ser lido quando algum caractere, como a tabulacao, vem antes da quebra de linha
+*/
+#define ASSINATURA_ARQUIVO "HFA2"
+#define ASSINATURA_DIRETORIO "HFAD"
+#define TABELA_COMPARTILHADA 1
+#define TAMANHO_CABECALHO 5
+#define TAMANHO_RODAPE 16
+#define TAMANHO_ENTRADA_MINIMA 23
+
+/**
+* Struct Membro
+* @brief Consiste em uma entrada do diretorio central de um arquivo de varios membros
+*/
+typedef struct Membro
+{
+    char nome[MAX_PATH]; /**< Nome com que o membro e listado e extraido*/
+    unsigned long tamanho_original; /**< Quantidade de caracteres do arquivo original*/
+    unsigned long tamanho_comprimido; /**< Quantidade de bytes ocupados pelo membro no arquivo*/
+    long long posicao; /**< Posicao do primeiro byte do membro no arquivo, ou -1 caso ele nao tenha sido gravado*/
+    unsigned long crc; /**< CRC-32 do arquivo original (@see atualizar_crc32)*/
+    int opcoes; /**< TABELA_COMPARTILHADA caso o membro nao traga a propria tabela de codigo*/
+} Membro;
+
+/**
+* Struct Entrada de Nome
+* @brief Consiste em uma posicao da tabela de espalhamento dos nomes de um lote (@see buscar_nome)
+*/
+typedef struct EntradaNome
+{
+    int indice; /**< Indice do nome no lote, ou -1 caso a posicao esteja livre*/
+    int proximo; /**< Proximo sufixo "~k" a ser tentado quando outro arquivo tiver este mesmo nome base*/
+} EntradaNome;
+
+/**
+* Struct Lote
+* @brief Consiste na lista de arquivos a serem comprimidos por um conjunto de threads trabalhadoras que compartilham um unico contador
+* Os arquivos comprimidos sao gravados separadamente em um diretorio de saida ou, caso o arquivo de varios membros esteja aberto, como
+* membros dele
+*/
+typedef struct Lote
+{
+    char** arquivos; /**< Caminhos dos arquivos de entrada*/
+    char** nomes; /**< Nome unico de cada arquivo dentro do lote, usado na saida (@see adicionar_arquivo)*/
+    EntradaNome* espalhamento; /**< Tabela de espalhamento dos nomes do lote, com enderecamento aberto (@see buscar_nome)*/
+    int tamanho_espalhamento; /**< Quantidade de posicoes da tabela de espalhamento, sempre uma potencia de dois*/
+    int quantidade; /**< Quantidade de arquivos do lote*/
+    int capacidade; /**< Quantidade de posicoes alocadas no vetor de arquivos*/
+    const char* diretorio_saida; /**< Diretorio em que os arquivos comprimidos sao gravados*/
+    volatile LONG proximo; /**< Indice do proximo arquivo a ser entregue a uma thread*/
+    volatile LONG falhas; /**< Quantidade de arquivos que nao puderam ser comprimidos*/
+    FILE* arquivo; /**< Arquivo de varios membros em gravacao, ou NULL no modo de diretorio de saida*/
+    const char* nome_arquivo; /**< Caminho do arquivo de varios membros, base dos arquivos temporarios de cada thread*/
+    Membro* membros; /**< Entrada do diretorio central de cada arquivo do lote*/
+    char (*tabela)[MIN]; /**< Tabela de codigo compartilhada pelos membros, ou NULL caso cada membro tenha a sua*/
+    int contar; /**< Indica a etapa em que as threads apenas somam as frequencias dos arquivos, usada para montar a tabela compartilhada*/
+    int frequencia_letras[TOTSIM]; /**< Soma das frequencias de todos os arquivos do lote*/
+    CRITICAL_SECTION secao; /**< Protege o arquivo de varios membros e a soma das frequencias*/
+    Estatisticas* estatisticas; /**< Contadores da execucao, ou NULL caso as estatisticas estejam desligadas*/
+} Lote;
+
+/**
+* Funcao Nome Base
+* @brief Retorna o trecho de @param caminho que vem depois do ultimo separador de diretorio
+*/
+const char* nome_base (const char* caminho)
+{
+    const char* p;
+    const char* base = caminho;
+    for (p=caminho; *p!=0; p++)
+    {
+        if (*p == '\\' || *p == '/')
+        {
+            base = p+1;
+        }
+    }
+    return base;
+}
+/**
+* Funcao Espalhar Nome
+* @brief Retorna o espalhamento FNV-1a de @param nome convertido para minusculas
+*/
+unsigned long espalhar_nome (const char* nome)
+{
+    unsigned long espalhamento = 2166136261UL;
+    for (; *nome!=0; nome++)
+    {
+        espalhamento = ((espalhamento ^ (unsigned char) tolower((unsigned char) *nome)) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return espalhamento;
+}
+/**
+* Funcao Buscar Nome
+* @brief Retorna a posicao da tabela de espalhamento do lote @param lote que guarda o nome @param nome ou, caso nenhum arquivo do lote o use,
+* a posicao livre em que ele deve ser inserido
+* A comparacao ignora maiusculas e minusculas, assim como o sistema de arquivos. As colisoes sao resolvidas por sondagem linear
+*/
+EntradaNome* buscar_nome (Lote* lote, const char* nome)
+{
+    unsigned long mascara = lote->tamanho_espalhamento - 1;
+    unsigned long i = espalhar_nome(nome) & mascara;
+    while (lote->espalhamento[i].indice >= 0 && _stricmp(lote->nomes[lote->espalhamento[i].indice], nome) != 0)
+    {
+        i = (i + 1) & mascara;
+    }
+    return &lote->espalhamento[i];
+}
+/**
+* Funcao Ampliar Espalhamento
+* @brief Garante que a tabela de espalhamento do lote @param lote tenha ao menos metade das posicoes livres apos a insercao de mais um nome
+* A tabela e dobrada quando necessario e os nomes ja inseridos sao redistribuidos. Retorna 1 em caso de sucesso e 0 caso nao haja memoria
+* suficiente
+*/
+int ampliar_espalhamento (Lote* lote)
+{
+    EntradaNome* antigo = lote->espalhamento;
+    int i, tamanho_antigo = lote->tamanho_espalhamento;
+    int tamanho = tamanho_antigo == 0 ? 128 : tamanho_antigo;
+    while (2*(lote->quantidade+1) > tamanho)
+    {
+        tamanho *= 2;
+    }
+    if (tamanho == tamanho_antigo)
+    {
+        return 1;
+    }
+    lote->espalhamento = (EntradaNome*) malloc(tamanho*sizeof(EntradaNome));
+    if (lote->espalhamento == NULL)
+    {
+        lote->espalhamento = antigo;
+        return 0;
+    }
+    lote->tamanho_espalhamento = tamanho;
+    for (i=0; i<tamanho; i++)
+    {
+        lote->espalhamento[i].indice = -1;
+    }
+    for (i=0; i<tamanho_antigo; i++)
+    {
+        if (antigo[i].indice >= 0)
+        {
+            *buscar_nome(lote, lote->nomes[antigo[i].indice]) = antigo[i];
+        }
+    }
+    free(antigo);
+    return 1;
+}
+/**
+* Funcao Adicionar Arquivo
+* @brief Acrescenta uma copia de @param caminho ao final do lote @param lote, dobrando o vetor de arquivos quando necessario
+* O arquivo recebe como nome no lote o seu nome base ou, caso outro arquivo do lote ja o use (@see buscar_nome), o nome base com "~2", "~3" e
+* assim por diante antes da extensao, de modo que dois arquivos nunca sejam gravados na mesma saida ou como membros de mesmo nome. O proximo
+* sufixo de cada nome base fica guardado na tabela de espalhamento, evitando testar novamente os sufixos ja usados.
+* Retorna 1 em caso de sucesso e 0 caso nao haja memoria suficiente
+*/
+int adicionar_arquivo (Lote* lote, const char* caminho)
+{
+    const char* base = nome_base(caminho);
+    const char* ponto = strrchr(base, '.');
+    char nome[2*MAX_PATH + 16];
+    EntradaNome* entrada;
+    int k, extensao = (ponto != NULL && ponto != base) ? (int) (ponto - base) : (int) strlen(base);
+    if (lote->quantidade == lote->capacidade)
+    {
+        int capacidade = lote->capacidade == 0 ? 64 : 2*lote->capacidade;
+        char** arquivos = (char**) realloc(lote->arquivos, capacidade*sizeof(char*));
+        char** nomes;
+        if (arquivos == NULL)
+        {
+            return 0;
+        }
+        lote->arquivos = arquivos;
+        nomes = (char**) realloc(lote->nomes, capacidade*sizeof(char*));
+        if (nomes == NULL)
+        {
+            return 0;
+        }
+        lote->nomes = nomes;
+        lote->capacidade = capacidade;
+    }
+    if (!ampliar_espalhamento(lote))
+    {
+        return 0;
+    }
+    strcpy(nome, base);
+    entrada = buscar_nome(lote, base);
+    if (entrada->indice >= 0)
+    {
+        k = entrada->proximo;
+        do
+        {
+            sprintf(nome, "%.*s~%d%s", extensao, base, k, base + extensao);
+            k++;
+        }
+        while (buscar_nome(lote, nome)->indice >= 0);
+        entrada->proximo = k;
+    }
+    lote->arquivos[lote->quantidade] = (char*) malloc(strlen(caminho)+1);
+    lote->nomes[lote->quantidade] = (char*) malloc(strlen(nome)+1);
+    if (lote->arquivos[lote->quantidade] == NULL || lote->nomes[lote->quantidade] == NULL)
+    {
+        free(lote->arquivos[lote->quantidade]);
+        free(lote->nomes[lote->quantidade]);
+        return 0;
+    }
+    strcpy(lote->arquivos[lote->quantidade], caminho);
+    strcpy(lote->nomes[lote->quantidade], nome);
+    entrada = buscar_nome(lote, nome);
+    entrada->indice = lote->quantidade;
+    entrada->proximo = 2;
+    lote->quantidade++;
+    return 1;
+}
+/**
+* Funcao Carregar Lote
+* @brief Preenche o lote @param lote com os arquivos indicados por @param origem
+* Caso @param origem seja um diretorio, todos os arquivos contidos diretamente nele entram no lote. Caso contrario, @param origem e lido
+* como uma lista com um caminho de arquivo por linha, ignorando as linhas vazias. Retorna 1 em caso de sucesso e 0 caso a origem nao possa
+* ser lida
+*/
+int carregar_lote (Lote* lote, const char* origem)
+{
+    char caminho[2*MAX_PATH];
+    DWORD atributos = GetFileAttributesA(origem);
+    if (atributos == INVALID_FILE_ATTRIBUTES)
+    {
+        return 0;
+    }
+    if (atributos & FILE_ATTRIBUTE_DIRECTORY)
+    {
+        WIN32_FIND_DATAA dados;
+        HANDLE busca;
+        sprintf(caminho, "%s\\*", origem);
+        busca = FindFirstFileA(caminho, &dados);
+        if (busca == INVALID_HANDLE_VALUE)
+        {
+            return 1;
+        }
+        do
+        {
+            if (!(dados.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                sprintf(caminho, "%s\\%s", origem, dados.cFileName);
+                if (!adicionar_arquivo(lote, caminho))
+                {
+                    FindClose(busca);
+                    return 0;
+                }
+            }
+        }
+        while (FindNextFileA(busca, &dados));
+        FindClose(busca);
+    }
+    else
+    {
+        FILE* lista = fopen(origem, "r");
+        if (lista == NULL)
+        {
+            return 0;
+        }
+        while (fgets(caminho, sizeof(caminho), lista) != NULL)
+        {
+            caminho[strcspn(caminho, "\r\n")] = 0;
+            if (caminho[0] != 0 && !adicionar_arquivo(lote, caminho))
+            {
+                fclose(lista);
+                return 0;
+            }
+        }
+        fclose(lista);
+    }
+    return 1;
+}
+/**
+* Funcao Liberar Lote
+* @brief Devolve a memoria ocupada pelos caminhos do lote @param lote
+*/
+void liberar_lote (Lote* lote)
+{
+    int i;
+    for (i=0; i<lote->quantidade; i++)
+    {
+        free(lote->arquivos[i]);
+        free(lote->nomes[i]);
+    }
+    free(lote->arquivos);
+    free(lote->nomes);
+    free(lote->espalhamento);
+    lote->arquivos = NULL;
+    lote->nomes = NULL;
+    lote->espalhamento = NULL;
+    lote->tamanho_espalhamento = 0;
+    lote->quantidade = 0;
+    lote->capacidade = 0;
+}
+/**
+* Funcao Escrever Inteiro
+* @brief Grava os @param bytes bytes menos significativos de @param valor no arquivo @param arq, do menos para o mais significativo
+*/
+void escrever_inteiro (FILE* arq, unsigned long long valor, int bytes)
+{
+    int i;
+    for (i=0; i<bytes; i++)
+    {
+        fputc((int) ((valor >> (8*i)) & 0xFF), arq);
+    }
+}
+/**
+* Funcao Ler Inteiro
+* @brief Le do arquivo @param arq um inteiro de @param bytes bytes gravado por @see escrever_inteiro
+*/
+unsigned long long ler_inteiro (FILE* arq, int bytes)
+{
+    unsigned long long valor = 0;
+    int i, c;
+    for (i=0; i<bytes; i++)
+    {
+        c = fgetc(arq);
+        if (c == EOF)
+        {
+            return 0;
+        }
+        valor |= ((unsigned long long) c) << (8*i);
+    }
+    return valor;
+}
+/**
+* Funcao Gravar Frequencias
+* @brief Grava no arquivo @param arq as frequencias @param frequencias: a quantidade de caracteres presentes (1 byte) e, para cada um, o
+* caractere (1 byte) e a frequencia (4 bytes). Retorna a quantidade de bytes gravados
+*/
+long gravar_frequencias (FILE* arq, const int frequencias[TOTSIM])
+{
+    int i, quantidade = 0;
+    for (i=1; i<TOTSIM; i++)
+    {
+        quantidade += frequencias[i] > 0;
+    }
+    fputc(quantidade, arq);
+    for (i=1; i<TOTSIM; i++)
+    {
+        if (frequencias[i] > 0)
+        {
+            fputc(i, arq);
+            escrever_inteiro(arq, frequencias[i], 4);
+        }
+    }
+    return 1 + 5*quantidade;
+}
+/**
+* Funcao Ler Frequencias
+* @brief Le do arquivo @param arq as frequencias gravadas por @see gravar_frequencias, sem passar de @param limite bytes
+* Retorna a quantidade de bytes lidos ou -1 caso a tabela seja invalida ou ultrapasse o limite
+*/
+long ler_frequencias (FILE* arq, int frequencias[TOTSIM], long long limite)
+{
+    int i, quantidade, simbolo;
+    memset(frequencias, 0, TOTSIM*sizeof(int));
+    quantidade = fgetc(arq);
+    if (quantidade == EOF || quantidade >= TOTSIM || 1 + 5*quantidade > limite)
+    {
+        return -1;
+    }
+    for (i=0; i<quantidade; i++)
+    {
+        simbolo = fgetc(arq);
+        if (simbolo <= 0 || simbolo >= TOTSIM || frequencias[simbolo] != 0)
+        {
+            return -1;
+        }
+        frequencias[simbolo] = (int) ler_inteiro(arq, 4);
+        if (frequencias[simbolo] <= 0)
+        {
+            return -1;
+        }
+    }
+    return 1 + 5*quantidade;
+}
+/**
+* Funcao Comprimir Arquivo
+* @brief Comprime o arquivo @param entrada gravando o resultado em @param saida, reaproveitando a arvore @param h
+* O arquivo comprimido comeca com ASSINATURA_COMPRIMIDO e o nome @param nome_registrado, usado na descompressao para recriar o arquivo
+* original, seguidos do tamanho original (4 bytes), do CRC-32 (4 bytes) e do mesmo conteudo de um membro do arquivo de varios membros: a tabela
+* de frequencias em binario (@see gravar_frequencias) e a saida de @see imprimir_codificado. Assim a descompressao (@see descomprimir_arquivo)
+* percorre a arvore como @see extrair_membro, sem os limites do formato em linhas de @see imprimir_tabela_codigo.
+* A arvore deve estar no estado inicial (@see criar_arvore_huffman ou @see reiniciar_arvore_huffman). Retorna o tamanho do arquivo comprimido
+* em caso de sucesso, 0 caso algum dos arquivos nao possa ser aberto e -1 caso a entrada tenha caracteres que a tabela nao representa ou nao
+* caiba na matriz de texto (@see frequencia_texto_arvore), situacao em que a saida nao e criada
+*/
+long long comprimir_arquivo (Huffman* h, const char* entrada, const char* saida, const char* nome_registrado)
+{
+    FILE* arq;
+    FILE* arq_comprimido;
+    char tabela[TOTSIM][MIN];
+    long long tamanho;
+    unsigned long caracteres = 0;
+    int representavel, i;
+    arq = fopen(entrada, "rb");
+    if (arq == NULL)
+    {
+        return 0;
+    }
+    representavel = frequencia_texto_arvore(h, arq);
+    fclose(arq);
+    if (!representavel)
+    {
+        return -1;
+    }
+    arq_comprimido = fopen(saida, "wb");
+    if (arq_comprimido == NULL)
+    {
+        return 0;
+    }
+    for (i=0; i<TOTSIM; i++)
+    {
+        caracteres += h->frequencia_letras[i];
+    }
+    fwrite(ASSINATURA_COMPRIMIDO, sizeof(char), 4, arq_comprimido);
+    fwrite(nome_registrado, sizeof(char), strlen(nome_registrado), arq_comprimido);
+    fwrite("\n", sizeof(char), 1, arq_comprimido);
+    escrever_inteiro(arq_comprimido, caracteres, 4);
+    escrever_inteiro(arq_comprimido, crc32_texto(h), 4);
+    montar_tabela_arquivo(h, tabela);
+    gravar_frequencias(arq_comprimido, h->frequencia_letras);
+    imprimir_codificado(h, arq_comprimido, tabela);
+    tamanho = _ftelli64(arq_comprimido);
+    fclose(arq_comprimido);
+    return tamanho;
+}
+/**
+* Funcao Somar Frequencias
+* @brief Le o arquivo de indice @param indice do lote @param lote e soma as frequencias dos seus caracteres as do lote inteiro
+* Utilizada na etapa de contagem que antecede a montagem da tabela compartilhada. Retorna 1 em caso de sucesso e 0 caso o arquivo nao possa ser
+* aberto ou tenha caracteres que a tabela nao representa, casos em que as suas frequencias nao sao somadas
+*/
+int somar_frequencias (Huffman* h, Lote* lote, int indice)
+{
+    int i;
+    FILE* arq = fopen(lote->arquivos[indice], "rb");
+    if (arq == NULL)
+    {
+        return 0;
+    }
+    if (!frequencia_texto_arvore(h, arq))
+    {
+        fclose(arq);
+        return 0;
+    }
+    fclose(arq);
+    EnterCriticalSection(&lote->secao);
+    for (i=0; i<TOTSIM; i++)
+    {
+        lote->frequencia_letras[i] += h->frequencia_letras[i];
+    }
+    LeaveCriticalSection(&lote->secao);
+    return 1;
+}
+/**
+* Funcao Comprimir Membro
+* @brief Comprime o arquivo de indice @param indice do lote @param lote como um membro do arquivo de varios membros
+* O membro e composto pela propria tabela de frequencias (@see gravar_frequencias), quando nao ha tabela compartilhada, seguida da saida de
+* @see imprimir_codificado. Ele e gravado primeiro no arquivo temporario @param temporario da thread e depois copiado, dentro da secao critica,
+* para o fim do arquivo de varios membros, registrando no diretorio a posicao, os tamanhos e o CRC-32. Retorna 1 em caso de sucesso e 0 caso
+* algum arquivo nao possa ser aberto ou a entrada tenha caracteres que a tabela nao representa
+*/
+int comprimir_membro (Huffman* h, Lote* lote, int indice, const char* temporario)
+{
+    FILE* arq;
+    FILE* tmp;
+    Membro* membro = &lote->membros[indice];
+    char tabela[TOTSIM][MIN];
+    char bloco[4096];
+    size_t lidos;
+    arq = fopen(lote->arquivos[indice], "rb");
+    if (arq == NULL)
+    {
+        return 0;
+    }
+    if (!frequencia_texto_arvore(h, arq))
+    {
+        fclose(arq);
+        return 0;
+    }
+    fclose(arq);
+    tmp = fopen(temporario, "w+b");
+    if (tmp == NULL)
+    {
+        return 0;
+    }
+    if (lote->tabela == NULL)
+    {
+        montar_tabela_arquivo(h, tabela);
+        gravar_frequencias(tmp, h->frequencia_letras);
+        imprimir_codificado(h, tmp, tabela);
+        membro->opcoes = 0;
+    }
+    else
+    {
+        imprimir_codificado(h, tmp, lote->tabela);
+        membro->opcoes = TABELA_COMPARTILHADA;
+    }
+    strncpy(membro->nome, lote->nomes[indice], MAX_PATH-1);
+    membro->tamanho_original = h->caracteres;
+    membro->crc = crc32_texto(h);
+    membro->tamanho_comprimido = (unsigned long) ftell(tmp);
+    rewind(tmp);
+    EnterCriticalSection(&lote->secao);
+    membro->posicao = _ftelli64(lote->arquivo);
+    while ((lidos = fread(bloco, sizeof(char), sizeof(bloco), tmp)) > 0)
+    {
+        fwrite(bloco, sizeof(char), lidos, lote->arquivo);
+    }
+    LeaveCriticalSection(&lote->secao);
+    fclose(tmp);
+    return 1;
+}
+/**
+* Funcao Trabalhador do Lote
+* @brief Corpo de cada thread do conjunto de trabalhadoras do modo lote
+* Cada thread aloca uma unica arvore de huffman e a reaproveita (@see reiniciar_arvore_huffman) em todos os arquivos que comprimir. Os arquivos
+* sao retirados do lote @param parametro atraves de um incremento atomico do indice do proximo arquivo, sem a necessidade de uma secao critica.
+* No modo de arquivo de varios membros, cada thread comprime os seus membros em um arquivo temporario proprio antes de copia-los para o arquivo.
+* Com as estatisticas ligadas, cada arquivo comprimido soma os seus bytes, a sua duracao e a sua tabela aos contadores do lote. As falhas so sao
+* informadas na compressao, e nao na etapa de contagem da tabela compartilhada, que le os mesmos arquivos
+*/
+DWORD WINAPI trabalhador_lote (LPVOID parametro)
+{
+    Lote* lote = (Lote*) parametro;
+    char saida[2*MAX_PATH];
+    LONG i;
+    Huffman* h = criar_arvore_huffman();
+    if (h == NULL)
+    {
+        puts("Memoria insuficiente!");
+        exit(1);
+    }
+    if (lote->arquivo != NULL)
+    {
+        sprintf(saida, "%s.%lu.tmp", lote->nome_arquivo, (unsigned long) GetCurrentThreadId());
+    }
+    while ((i = InterlockedIncrement(&lote->proximo) - 1) < lote->quantidade)
+    {
+        const char* base = lote->nomes[i];
+        long long gravados = 0;
+        LONGLONG inicio = relogio();
+        if (lote->estatisticas != NULL)
+        {
+            InterlockedExchange(&lote->estatisticas->arquivos_pendentes, lote->quantidade - i - 1);
+        }
+        if (lote->contar)
+        {
+            gravados = somar_frequencias(h, lote, i);
+        }
+        else if (lote->arquivo != NULL)
+        {
+            if (comprimir_membro(h, lote, i, saida))
+            {
+                gravados = lote->membros[i].tamanho_comprimido;
+            }
+        }
+        else
+        {
+            sprintf(saida, "%s\\%s%s", lote->diretorio_saida, base, EXTENSAO_COMPRIMIDO);
+            gravados = comprimir_arquivo(h, lote->arquivos[i], saida, base);
+        }
+        if (gravados <= 0 && !lote->contar)
+        {
+            printf("Falha ao comprimir %s\n", lote->arquivos[i]);
+            InterlockedIncrement(&lote->falhas);
+        }
+        if (lote->estatisticas != NULL && !lote->contar)
+        {
+            registrar_latencia(lote->estatisticas, ETAPA_ARQUIVO, inicio);
+            if (gravados > 0)
+            {
+                somar_bytes(lote->estatisticas, h->caracteres, gravados);
+                somar_contadores(lote->estatisticas, 0, lote->tabela == NULL, 0);
+                InterlockedIncrement(&lote->estatisticas->arquivos);
+            }
+            else
+            {
+                InterlockedIncrement(&lote->estatisticas->falhas);
+            }
+        }
+        reiniciar_arvore_huffman(h);
+    }
+    if (lote->arquivo != NULL)
+    {
+        remove(saida);
+    }
+    liberar_arvore_huffman(h);
+    return 0;
+}
+/**
+* Funcao Numero de Processadores
+* @brief Retorna a quantidade de processadores logicos da maquina, utilizada como numero padrao de threads do modo lote
+*/
+int numero_processadores ()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int) info.dwNumberOfProcessors : 1;
+}
+/**
+* Funcao Comprimir Lote
+* @brief Comprime todos os arquivos do lote @param lote utilizando @param threads threads trabalhadoras
+* As threads sao criadas uma unica vez para o lote inteiro e cada uma comprime quantos arquivos conseguir retirar do lote. A espera e feita
+* thread a thread, ja que WaitForMultipleObjects nao aceita mais que MAXIMUM_WAIT_OBJECTS threads. Retorna a quantidade de arquivos que nao
+* puderam ser comprimidos
+*/
+int comprimir_lote (Lote* lote, int threads)
+{
+    HANDLE* trabalhadoras;
+    int i;
+    if (threads > lote->quantidade)
+    {
+        threads = lote->quantidade;
+    }
+    if (threads < 1)
+    {
+        return 0;
+    }
+    lote->proximo = 0;
+    lote->falhas = 0;
+    trabalhadoras = (HANDLE*) malloc(threads*sizeof(HANDLE));
+    if (trabalhadoras == NULL)
+    {
+        puts("Memoria insuficiente!");
+        exit(1);
+    }
+    for (i=0; i<threads; i++)
+    {
+        trabalhadoras[i] = CreateThread(NULL, 0, trabalhador_lote, lote, 0, NULL);
+        if (trabalhadoras[i] == NULL)
+        {
+            puts("Nao foi possivel criar as threads!");
+            exit(1);
+        }
+    }
+    for (i=0; i<threads; i++)
+    {
+        WaitForSingleObject(trabalhadoras[i], INFINITE);
+        CloseHandle(trabalhadoras[i]);
+    }
+    free(trabalhadoras);
+    return lote->falhas;
+}
+/**
+* Funcao Modo Lote
+* @brief Trata a linha de comando "-lote <diretorio|lista> <diretorio_saida> [threads]"
+* Carrega o lote, cria o diretorio de saida caso ele ainda nao exista e comprime todos os arquivos, imprimindo ao final a quantidade de
+* arquivos comprimidos e o tempo computacional do lote inteiro. Caso @param estatisticas nao seja NULL, os contadores da execucao sao
+* gravados periodicamente nesse arquivo (@see gravar_estatisticas)
+*/
+int modo_lote (int argc, char* argv[], const char* estatisticas)
+{
+    Lote lote;
+    Estatisticas contadores;
+    int threads, falhas, inicio, fim;
+    memset(&lote, 0, sizeof(lote));
+    threads = argc == 5 ? atoi(argv[4]) : numero_processadores();
+    if (threads < 1)
+    {
+        puts("Argumentos invalidos!");
+        return 0;
+    }
+    if (!carregar_lote(&lote, argv[2]))
+    {
+        puts("Arquivo nao encontrado!");
+        liberar_lote(&lote);
+        return 0;
+    }
+    CreateDirectoryA(argv[3], NULL);
+    lote.diretorio_saida = argv[3];
+    if (estatisticas != NULL)
+    {
+        iniciar_estatisticas(&contadores, estatisticas);
+        lote.estatisticas = &contadores;
+    }
+    inicio = GetTickCount();
+    falhas = comprimir_lote(&lote, threads);
+    fim = GetTickCount();
+    if (estatisticas != NULL)
+    {
+        encerrar_estatisticas(&contadores);
+    }
+    printf("Arquivos comprimidos: %d de %d\n", lote.quantidade-falhas, lote.quantidade);
+    printf("Tempo computacional: %d\n", fim-inicio);
+    liberar_lote(&lote);
+    return 0;
+}
+/**
+* Funcao Gravar Diretorio
+* @brief Grava no fim do arquivo @param arq o diretorio central com os @param quantidade membros de @param membros, seguido do rodape
+* Cada entrada e composta pelo tamanho do nome (2 bytes), o nome, o tamanho original (4 bytes), a posicao (8 bytes), o tamanho comprimido
+* (4 bytes), o CRC-32 (4 bytes) e as opcoes do membro (1 byte). Os membros que nao foram gravados sao omitidos. Retorna a quantidade de
+* entradas gravadas
+*/
+int gravar_diretorio (FILE* arq, Membro* membros, int quantidade)
+{
+    long long posicao = _ftelli64(arq);
+    int i, gravados = 0;
+    for (i=0; i<quantidade; i++)
+    {
+        if (membros[i].posicao >= 0)
+        {
+            int tam = strlen(membros[i].nome);
+            escrever_inteiro(arq, tam, 2);
+            fwrite(membros[i].nome, sizeof(char), tam, arq);
+            escrever_inteiro(arq, membros[i].tamanho_original, 4);
+            escrever_inteiro(arq, membros[i].posicao, 8);
+            escrever_inteiro(arq, membros[i].tamanho_comprimido, 4);
+            escrever_inteiro(arq, membros[i].crc, 4);
+            fputc(membros[i].opcoes, arq);
+            gravados++;
+        }
+    }
+    escrever_inteiro(arq, posicao, 8);
+    escrever_inteiro(arq, gravados, 4);
+    fwrite(ASSINATURA_DIRETORIO, sizeof(char), 4, arq);
+    return gravados;
+}
+/**
+* Funcao Ler Diretorio
+* @brief Le o diretorio central do arquivo de varios membros @param arq a partir do rodape, sem percorrer os membros
+* Retorna o vetor de membros, cuja quantidade e guardada em @param quantidade, ou NULL caso o arquivo nao seja um arquivo de varios membros,
+* a quantidade de membros nao caiba no diretorio ou algum membro ultrapasse o inicio do diretorio
+*/
+Membro* ler_diretorio (FILE* arq, int* quantidade)
+{
+    char assinatura[5];
+    long long posicao, tamanho_arquivo;
+    Membro* membros;
+    int i, tam;
+    assinatura[4] = 0;
+    if (fread(assinatura, sizeof(char), 4, arq) != 4 || strcmp(assinatura, ASSINATURA_ARQUIVO) != 0)
+    {
+        return NULL;
+    }
+    if (_fseeki64(arq, -TAMANHO_RODAPE, SEEK_END) != 0)
+    {
+        return NULL;
+    }
+    tamanho_arquivo = _ftelli64(arq);
+    posicao = (long long) ler_inteiro(arq, 8);
+    *quantidade = (int) ler_inteiro(arq, 4);
+    if (fread(assinatura, sizeof(char), 4, arq) != 4 || strcmp(assinatura, ASSINATURA_DIRETORIO) != 0 || posicao < TAMANHO_CABECALHO ||
+        posicao > tamanho_arquivo || *quantidade < 0 || *quantidade > (tamanho_arquivo - posicao) / TAMANHO_ENTRADA_MINIMA)
+    {
+        return NULL;
+    }
+    membros = (Membro*) calloc(*quantidade > 0 ? *quantidade : 1, sizeof(Membro));
+    if (membros == NULL || _fseeki64(arq, posicao, SEEK_SET) != 0)
+    {
+        free(membros);
+        return NULL;
+    }
+    for (i=0; i<*quantidade; i++)
+    {
+        tam = (int) ler_inteiro(arq, 2);
+        if (tam >= MAX_PATH || fread(membros[i].nome, sizeof(char), tam, arq) != (size_t) tam)
+        {
+            free(membros);
+            return NULL;
+        }
+        membros[i].tamanho_original = (unsigned long) ler_inteiro(arq, 4);
+        membros[i].posicao = (long long) ler_inteiro(arq, 8);
+        membros[i].tamanho_comprimido = (unsigned long) ler_inteiro(arq, 4);
+        membros[i].crc = (unsigned long) ler_inteiro(arq, 4);
+        membros[i].opcoes = fgetc(arq);
+        if (membros[i].posicao < TAMANHO_CABECALHO || membros[i].posicao > posicao ||
+            (long long) membros[i].tamanho_comprimido > posicao - membros[i].posicao)
+        {
+            free(membros);
+            return NULL;
+        }
+    }
+    return membros;
+}
+/**
+* Funcao Escrever Membro
+* @brief Converte os @param n caracteres codificados no vetor binario @param codificacao percorrendo a arvore @param raiz, escrevendo-os no
+* arquivo @param arq e devolvendo o seu CRC-32 em @param crc. Retorna 1 em caso de sucesso e 0 caso a codificacao termine antes
+* Uma arvore de uma unica folha tem codigos vazios, de modo que todos os caracteres sao essa folha
+*/
+int escrever_membro (FILE* arq, No* raiz, const char codificacao[], unsigned long n, unsigned long* crc)
+{
+    No* p = raiz;
+    unsigned long k = 0;
+    unsigned char caractere;
+    long i = 0;
+    *crc = 0;
+    while (k < n)
+    {
+        if (raiz == NULL)
+        {
+            return 0;
+        }
+        if (p->filhoesq != NULL)
+        {
+            if (codificacao[i] == 0)
+            {
+                return 0;
+            }
+            p = codificacao[i] == '1' ? p->filhodir : p->filhoesq;
+            i++;
+        }
+        if (p->filhoesq == NULL)
+        {
+            caractere = (unsigned char) p->letra;
+            fputc(caractere, arq);
+            *crc = atualizar_crc32(*crc, &caractere, 1);
+            k++;
+            p = raiz;
+        }
+    }
+    return 1;
+}
+/**
+* Funcao Extrair Membro
+* @brief Descomprime apenas o membro @param membro do arquivo de varios membros @param arq, gravando o resultado em @param saida
+* A leitura comeca diretamente na posicao registrada no diretorio, sem passar pelos demais membros, e nao ultrapassa o fim do membro. A arvore e
+* montada novamente a partir da tabela de frequencias do membro ou da tabela compartilhada, com o mesmo limite de BITS_MAXIMOS bits usado na
+* compressao (@see montar_tabela_limitada). Assim como na compressao, a saida e aberta em modo binario, de modo que o membro extraido seja
+* identico byte a byte ao arquivo original. Um membro cuja codificacao nao caiba nos indices inteiros de @see gerar_binario e considerado
+* invalido. Retorna 1 caso o CRC-32 do resultado confira com o do diretorio e 0 caso contrario, caso o membro seja invalido ou caso a saida
+* nao possa ser criada
+*/
+int extrair_membro (FILE* arq, Membro* membro, const char* saida)
+{
+    Huffman* h;
+    char tabela[TOTSIM][MIN];
+    char total_char[MIN];
+    char* codificacao;
+    int frequencias[TOTSIM];
+    FILE* destino;
+    long long fim = membro->posicao + membro->tamanho_comprimido;
+    long long restante;
+    unsigned long crc;
+    int sucesso;
+    if (membro->tamanho_original == 0)
+    {
+        destino = fopen(saida, "wb");
+        if (destino == NULL)
+        {
+            return 0;
+        }
+        fclose(destino);
+        return membro->crc == 0;
+    }
+    h = criar_arvore_huffman();
+    if (h == NULL)
+    {
+        puts("Memoria insuficiente!");
+        exit(1);
+    }
+    if (membro->opcoes & TABELA_COMPARTILHADA)
+    {
+        _fseeki64(arq, TAMANHO_CABECALHO, SEEK_SET);
+        sucesso = ler_frequencias(arq, frequencias, membro->posicao - TAMANHO_CABECALHO) >= 0;
+        _fseeki64(arq, membro->posicao, SEEK_SET);
+    }
+    else
+    {
+        _fseeki64(arq, membro->posicao, SEEK_SET);
+        sucesso = ler_frequencias(arq, frequencias, membro->tamanho_comprimido) >= 0;
+    }
+    if (sucesso)
+    {
+        ler_linha(arq, total_char, MIN);
+    }
+    restante = fim - _ftelli64(arq);
+    if (!sucesso || restante < 0 || restante > (INT_MAX - 1) / 8)
+    {
+        liberar_arvore_huffman(h);
+        return 0;
+    }
+    montar_tabela_limitada(h, frequencias, tabela, BITS_MAXIMOS);
+    codificacao = (char*) malloc(8*(size_t) restante + 1);
+    if (codificacao == NULL)
+    {
+        puts("Memoria insuficiente!");
+        exit(1);
+    }
+    gerar_binario(arq, codificacao, atoi(total_char), (long) restante);
+    destino = fopen(saida, "wb");
+    if (destino == NULL)
+    {
+        free(codificacao);
+        liberar_arvore_huffman(h);
+        return 0;
+    }
+    sucesso = escrever_membro(destino, h->cabeca->proximo, codificacao, membro->tamanho_original, &crc);
+    fclose(destino);
+    free(codificacao);
+    liberar_arvore_huffman(h);
+    return sucesso && crc == membro->crc;
+}
+/**
+* Funcao Descomprimir Arquivo
+* @brief Restaura o arquivo comprimido @param arq por @see comprimir_arquivo, ja lida a assinatura, com o nome gravado no cabecalho
+* O conteudo depois do cabecalho e decodificado como um membro sem tabela compartilhada que vai ate o fim do arquivo (@see extrair_membro).
+* Retorna 1 caso o CRC-32 do resultado confira com o gravado e 0 caso contrario ou caso o arquivo seja invalido
+*/
+int descomprimir_arquivo (FILE* arq)
+{
+    Membro membro;
+    long long fim;
+    memset(&membro, 0, sizeof(membro));
+    ler_linha(arq, membro.nome, MAX_PATH);
+    membro.tamanho_original = (unsigned long) ler_inteiro(arq, 4);
+    membro.crc = (unsigned long) ler_inteiro(arq, 4);
+    membro.posicao = _ftelli64(arq);
+    if (membro.nome[0] == 0 || _fseeki64(arq, 0, SEEK_END) != 0)
+    {
+        return 0;
+    }
+    fim = _ftelli64(arq);
+    if (fim < membro.posicao || fim - membro.posicao > 0xFFFFFFFFLL)
+    {
+        return 0;
+    }
+    membro.tamanho_comprimido = (unsigned long) (fim - membro.posicao);
+    return extrair_membro(arq, &membro, membro.nome);
+}
+/**
+* Funcao Modo Arquivar
+* @brief Trata a linha de comando "-arquivar <diretorio|lista> <arquivo> [threads] [-tabela-unica]"
+* Comprime todos os arquivos do lote como membros de um unico arquivo, usando o mesmo conjunto de threads do modo lote. Com a opcao
+* -tabela-unica, uma etapa anterior soma as frequencias de todos os arquivos e uma unica tabela de codigo, gravada logo apos o cabecalho,
+* e usada por todos os membros. O diretorio central e gravado no fim do arquivo. Caso @param estatisticas nao seja NULL, os contadores da
+* execucao sao gravados periodicamente nesse arquivo (@see gravar_estatisticas)
+*/
+int modo_arquivar (int argc, char* argv[], const char* estatisticas)
+{
+    Lote lote;
+    Estatisticas contadores;
+    Huffman* h;
+    char tabela[TOTSIM][MIN];
+    int threads = numero_processadores(), unica = 0, i, falhas, inicio, fim;
+    memset(&lote, 0, sizeof(lote));
+    for (i=4; i<argc; i++)
+    {
+        if (strcmp(argv[i], "-tabela-unica") == 0)
+        {
+            unica = 1;
+        }
+        else
+        {
+            threads = atoi(argv[i]);
+        }
+    }
+    if (threads < 1)
+    {
+        puts("Argumentos invalidos!");
+        return 0;
+    }
+    if (!carregar_lote(&lote, argv[2]))
+    {
+        puts("Arquivo nao encontrado!");
+        liberar_lote(&lote);
+        return 0;
+    }
+    lote.arquivo = fopen(argv[3], "wb");
+    lote.membros = (Membro*) calloc(lote.quantidade > 0 ? lote.quantidade : 1, sizeof(Membro));
+    if (lote.arquivo == NULL || lote.membros == NULL)
+    {
+        puts("Nao foi possivel criar o arquivo!");
+        exit(1);
+    }
+    for (i=0; i<lote.quantidade; i++)
+    {
+        lote.membros[i].posicao = -1;
+    }
+    lote.nome_arquivo = argv[3];
+    InitializeCriticalSection(&lote.secao);
+    if (estatisticas != NULL)
+    {
+        iniciar_estatisticas(&contadores, estatisticas);
+        lote.estatisticas = &contadores;
+    }
+    inicio = GetTickCount();
+    fwrite(ASSINATURA_ARQUIVO, sizeof(char), 4, lote.arquivo);
+    fputc(unica ? TABELA_COMPARTILHADA : 0, lote.arquivo);
+    if (unica)
+    {
+        lote.contar = 1;
+        comprimir_lote(&lote, threads);
+        lote.contar = 0;
+        h = criar_arvore_huffman();
+        montar_tabela_limitada(h, lote.frequencia_letras, tabela, BITS_MAXIMOS);
+        liberar_arvore_huffman(h);
+        gravar_frequencias(lote.arquivo, lote.frequencia_letras);
+        lote.tabela = tabela;
+        somar_contadores(lote.estatisticas, 0, 1, 0);
+    }
+    falhas = comprimir_lote(&lote, threads);
+    gravar_diretorio(lote.arquivo, lote.membros, lote.quantidade);
+    fclose(lote.arquivo);
+    fim = GetTickCount();
+    if (estatisticas != NULL)
+    {
+        encerrar_estatisticas(&contadores);
+    }
+    printf("Arquivos comprimidos: %d de %d\n", lote.quantidade-falhas, lote.quantidade);
+    printf("Tempo computacional: %d\n", fim-inicio);
+    DeleteCriticalSection(&lote.secao);
+    free(lote.membros);
+    liberar_lote(&lote);
+    return 0;
+}
+/**
+* Funcao Modo Listar
+* @brief Trata a linha de comando "-listar <arquivo>", imprimindo nome, tamanho original, tamanho comprimido, posicao e CRC-32 de cada membro
+*/
+int modo_listar (char* argv[])
+{
+    int i, quantidade;
+    Membro* membros;
+    FILE* arq = fopen(argv[2], "rb");
+    if (arq == NULL)
+    {
+        puts("Arquivo nao encontrado!");
+        return 0;
+    }
+    membros = ler_diretorio(arq, &quantidade);
+    fclose(arq);
+    if (membros == NULL)
+    {
+        puts("Arquivo invalido!");
+        return 0;
+    }
+    for (i=0; i<quantidade; i++)
+    {
+        printf("%s %lu %lu %lld %08lx\n", membros[i].nome, membros[i].tamanho_original, membros[i].tamanho_comprimido,
+               membros[i].posicao, membros[i].crc);
+    }
+    printf("Membros: %d\n", quantidade);
+    free(membros);
+    return 0;
+}
+/**
+* Funcao Nome de Membro Seguro
+* @brief Retorna 1 caso o nome de membro @param nome possa ser usado como nome de arquivo no diretorio atual e 0 caso contrario
+* Os nomes gravados por @see modo_arquivar sao nomes base (@see nome_base), de modo que um nome vazio, "." ou "..", ou com separador de
+* diretorio ou prefixo de unidade, so aparece em um arquivo adulterado e poderia levar a extracao para fora do diretorio atual
+*/
+int nome_membro_seguro (const char* nome)
+{
+    return nome[0] != 0 && strcmp(nome, ".") != 0 && strcmp(nome, "..") != 0 && strpbrk(nome, "\\/:") == NULL;
+}
+/**
+* Funcao Modo Extrair
+* @brief Trata a linha de comando "-extrair <arquivo> <membro> [saida]"
+* Procura o membro no diretorio central e o descomprime com @see extrair_membro. Sem o argumento de saida, o arquivo criado recebe o nome do membro,
+* desde que ele seja um nome seguro (@see nome_membro_seguro)
+*/
+int modo_extrair (int argc, char* argv[])
+{
+    int i, quantidade;
+    Membro* membros;
+    FILE* arq = fopen(argv[2], "rb");
+    if (arq == NULL)
+    {
+        puts("Arquivo nao encontrado!");
+        return 0;
+    }
+    membros = ler_diretorio(arq, &quantidade);
+    if (membros == NULL)
+    {
+        puts("Arquivo invalido!");
+        fclose(arq);
+        return 0;
+    }
+    for (i=0; i<quantidade && strcmp(membros[i].nome, argv[3])!=0; i++);
+    if (i == quantidade)
+    {
+        puts("Membro nao encontrado!");
+    }
+    else if (argc == 4 && !nome_membro_seguro(membros[i].nome))
+    {
+        puts("Nome de membro invalido!");
+    }
+    else if (!extrair_membro(arq, &membros[i], argc == 5 ? argv[4] : membros[i].nome))
+    {
+        puts("Falha na verificacao do membro!");
+    }
+    fclose(arq);
+    free(membros);
+    return 0;
+}
+/**
+* Defines do Modo Fluxo
+* ASSINATURA_FLUXO marca o inicio de um arquivo comprimido em fluxo
+* TAMANHO_BLOCO representa a quantidade maxima de caracteres de cada bloco do fluxo e de cada registro gravado
+* TAMANHO_CODIFICADO representa o espaco reservado para os registros gravados a partir de um bloco, que cabem nele mesmo no pior caso de codigos
+* de BITS_MAXIMOS bits
+* Os tipos de registro sao:
+* BLOCO_ANTERIOR, codificado com a tabela montada a partir do histograma do registro anterior, com codigos de no maximo BITS_RAPIDO bits;
+* BLOCO_CRU, copiado sem compressao;
+* BLOCO_FIM, marcador do fim do fluxo;
+* BLOCO_REPETIDO, codificado com a mesma arvore do registro codificado anterior;
+* BLOCO_TABELA, codificado com a tabela do proprio registro, gravada no cabecalho;
+* BLOCO_REUSO, codificado com uma das ultimas RECENTES tabelas gravadas, indicada no cabecalho;
+* BLOCO_CONTEXTO, codificado com uma tabela para cada contexto, escolhida pelo caractere anterior (@see contexto_caractere).
+* BLOCO_INVALIDO nunca e gravado, apenas indica ao pipeline um fluxo comprimido invalido
+*/
+#define ASSINATURA_FLUXO "HFS1"
+#define TAMANHO_BLOCO 65536
+#define TAMANHO_CODIFICADO (4*TAMANHO_BLOCO)
+#define BLOCO_ANTERIOR 0
+#define BLOCO_CRU 1
+#define BLOCO_FIM 2
+#define BLOCO_REPETIDO 3
+#define BLOCO_TABELA 4
+#define BLOCO_REUSO 5
+#define BLOCO_CONTEXTO 6
+#define BLOCO_INVALIDO -1
+
+/**
+* Defines dos Niveis de Compressao
+* NIVEL_RAPIDO, NIVEL_PADRAO e NIVEL_MELHOR sao os niveis aceitos por "-fluxo", do mais rapido ao de maior compressao
+* BITS_RAPIDO representa o tamanho maximo dos codigos do nivel rapido, que mantem a arvore rasa e a tabela rapida de montar a cada registro
+* TOLERANCIA_RAPIDO representa quanto os bits por caractere podem crescer, no nivel rapido, antes que a tabela seja montada novamente
+* RECENTES representa quantas tabelas gravadas ficam disponiveis para o reuso
+* CONTEXTOS representa a quantidade de classes de caractere anterior usadas como contexto de ordem 1
+* TAMANHO_SEGMENTO representa a menor parte de um bloco considerada pela divisao em registros do nivel melhor
+*/
+#define NIVEL_RAPIDO 1
+#define NIVEL_PADRAO 2
+#define NIVEL_MELHOR 3
+#define BITS_RAPIDO 11
+#define TOLERANCIA_RAPIDO 1.05
+#define RECENTES 4
+#define CONTEXTOS 6
+#define TAMANHO_SEGMENTO 4096
+
+/**
+* Funcao Preparar Bloco
+* @brief Monta em @param h a arvore e em @param tabela a tabela de codigo usadas em um bloco, a partir do histograma @param frequencias do bloco anterior,
+* com codigos de no maximo @param max_bits bits, que nao pode passar de BITS_MAXIMOS
+* Todos os caracteres de 1 a TOTSIM-1 recebem uma unidade a mais de frequencia, de modo que a tabela contem qualquer caractere que o bloco atual
+* venha a ter, mesmo que ele nao tenha aparecido no anterior. Compressor e descompressor chamam esta funcao com o mesmo histograma e por isso
+* chegam a mesma arvore sem que nenhuma tabela seja gravada
+*/
+void preparar_bloco (Huffman* h, const int frequencias[256], char tabela[][MIN], int max_bits)
+{
+    int suavizado[TOTSIM];
+    int i;
+    suavizado[0] = 0;
+    for (i=1; i<TOTSIM; i++)
+    {
+        suavizado[i] = frequencias[i] + 1;
+    }
+    montar_tabela_limitada(h, suavizado, tabela, max_bits);
+}
+/**
+* Funcao Codificar e Contar
+* @brief Equivalente a @see codificar_simbolos, mas que tambem soma a @param frequencias as ocorrencias de cada caractere de @param simbolos
+* Permite que o histograma do bloco atual seja coletado na mesma leitura que o codifica
+*/
+void codificar_e_contar (EscritorBits* e, const unsigned char* simbolos, int n, const CodigoHuffman codigos[256], int frequencias[256])
+{
+    unsigned long long acumulador = e->acumulador;
+    unsigned char* saida = e->saida;
+    int bits = e->bits, i = 0;
+    const CodigoHuffman* c;
+    for (; i+SIMBOLOS_POR_PASSO <= n; i+=SIMBOLOS_POR_PASSO)
+    {
+        const CodigoHuffman* c0 = &codigos[simbolos[i]];
+        const CodigoHuffman* c1 = &codigos[simbolos[i+1]];
+        const CodigoHuffman* c2 = &codigos[simbolos[i+2]];
+        int t01 = c0->tamanho + c1->tamanho;
+        unsigned long long passo = c0->bits | (c1->bits >> c0->tamanho) | (c2->bits >> t01);
+        frequencias[simbolos[i]]++;
+        frequencias[simbolos[i+1]]++;
+        frequencias[simbolos[i+2]]++;
+        acumulador |= passo >> bits;
+        bits += t01 + c2->tamanho;
+        saida = descarregar_bits(saida, &acumulador, &bits);
+    }
+    for (; i<n; i++)
+    {
+        frequencias[simbolos[i]]++;
+        c = &codigos[simbolos[i]];
+        acumulador |= c->bits >> bits;
+        bits += c->tamanho;
+        saida = descarregar_bits(saida, &acumulador, &bits);
+    }
+    e->acumulador = acumulador;
+    e->bits = bits;
+    e->saida = saida;
+}
+/**
+* Funcao Decodificar Bloco
+* @brief Percorre a arvore com raiz @param raiz seguindo os bits de @param entrada ate obter os @param n caracteres do bloco em @param saida
+* Retorna 1 em caso de sucesso e 0 caso os @param tamanho bytes de entrada terminem antes do ultimo caractere
+*/
+int decodificar_bloco (No* raiz, const unsigned char* entrada, long tamanho, unsigned char* saida, int n)
+{
+    No* p = raiz;
+    long posicao = 0, fim = 8*tamanho;
+    int k = 0;
+    while (k < n)
+    {
+        if (posicao >= fim)
+        {
+            return 0;
+        }
+        p = ((entrada[posicao >> 3] >> (7 - (posicao & 7))) & 1) ? p->filhodir : p->filhoesq;
+        posicao++;
+        if (p->filhoesq == NULL)
+        {
+            saida[k] = (unsigned char) p->letra;
+            k++;
+            p = raiz;
+        }
+    }
+    return 1;
+}
+/**
+* Struct Tabela Recente
+* @brief Consiste em uma tabela gravada em um registro BLOCO_TABELA, guardada para que registros seguintes possam reusa-la
+*/
+typedef struct TabelaRecente
+{
+    int frequencias[TOTSIM]; /**< Frequencias gravadas no registro, a partir das quais a arvore e montada novamente*/
+    CodigoHuffman codigos[256]; /**< Codigos da tabela, usados pelo compressor para estimar o custo do reuso*/
+} TabelaRecente;
+
+/**
+* Struct Estado do Fluxo
+* @brief Consiste no estado mantido de um registro para o outro, que precisa evoluir da mesma forma no compressor e no descompressor
+*/
+typedef struct EstadoFluxo
+{
+    Huffman* h; /**< Arvore de trabalho, usada para montar todas as tabelas*/
+    int nivel; /**< Nivel de compressao, usado apenas pelo compressor*/
+    int frequencias[256]; /**< Histograma do registro anterior, coletado no compressor durante a codificacao do nivel rapido*/
+    No* atual; /**< Arvore do registro codificado anterior, usada pelo descompressor*/
+    CodigoHuffman codigos[256]; /**< Codigos do registro codificado anterior, usados pelo compressor*/
+    int atual_valido; /**< Indica, no compressor, que os codigos do registro anterior podem ser repetidos*/
+    double referencia; /**< Bits por caractere do primeiro registro codificado com a tabela atual no nivel rapido*/
+    double ultimo; /**< Bits por caractere do ultimo registro codificado com a tabela atual no nivel rapido*/
+    TabelaRecente recentes[RECENTES]; /**< Ultimas tabelas gravadas, da mais recente para a mais antiga*/
+    int quantidade_recentes; /**< Quantidade de tabelas recentes validas*/
+    int tabelas_montadas; /**< Tabelas montadas para os registros desde a ultima publicacao (@see publicar_estado)*/
+    int registros_crus; /**< Registros crus desde a ultima publicacao*/
+} EstadoFluxo;
+
+/**
+* Funcao Iniciar Estado do Fluxo
+* @brief Prepara o estado @param e para o inicio de um fluxo comprimido no nivel @param nivel
+*/
+void iniciar_estado_fluxo (EstadoFluxo* e, int nivel)
+{
+    memset(e, 0, sizeof(EstadoFluxo));
+    e->nivel = nivel;
+    e->h = criar_arvore_huffman();
+    if (e->h == NULL)
+    {
+        puts("Memoria insuficiente!");
+        exit(1);
+    }
+}
+/**
+* Funcao Liberar Estado do Fluxo
+* @brief Devolve a memoria das arvores do estado @param e
+*/
+void liberar_estado_fluxo (EstadoFluxo* e)
+{
+    liberar_nos(e->atual);
+    liberar_arvore_huffman(e->h);
+}
+/**
+* Funcao Publicar Estado
+* @brief Soma aos contadores @param s um bloco processado e as tabelas e registros crus acumulados no estado @param e, zerando-os no estado
+*/
+void publicar_estado (Estatisticas* s, EstadoFluxo* e)
+{
+    somar_contadores(s, 1, e->tabelas_montadas, e->registros_crus);
+    e->tabelas_montadas = 0;
+    e->registros_crus = 0;
+}
+/**
+* Funcao Destacar Arvore
+* @brief Retira da arvore de trabalho @param h a arvore montada nela e a retorna, deixando @param h livre para montar outra
+* A arvore retornada deve ser liberada com @see liberar_nos
+*/
+No* destacar_arvore (Huffman* h)
+{
+    No* raiz = h->cabeca->proximo;
+    h->cabeca->proximo = NULL;
+    h->tamanho = 0;
+    return raiz;
+}
+/**
+* Funcao Gravar Inteiro no Vetor
+* @brief Equivalente a @see escrever_inteiro, mas gravando em @param destino em vez de em um arquivo
+*/
+void gravar_inteiro_vetor (unsigned char* destino, unsigned long valor, int bytes)
+{
+    int i;
+    for (i=0; i<bytes; i++)
+    {
+        destino[i] = (unsigned char) ((valor >> (8*i)) & 0xFF);
+    }
+}
+/**
+* Funcao Ler Inteiro do Vetor
+* @brief Equivalente a @see ler_inteiro, mas lendo de @param origem em vez de de um arquivo
+*/
+unsigned long ler_inteiro_vetor (const unsigned char* origem, int bytes)
+{
+    unsigned long valor = 0;
+    int i;
+    for (i=0; i<bytes; i++)
+    {
+        valor |= ((unsigned long) origem[i]) << (8*i);
+    }
+    return valor;
+}
+/**
+* Funcao Contexto do Caractere
+* @brief Retorna a classe do caractere @param c usada como contexto de ordem 1 do caractere seguinte
+* As classes sao: vogal minuscula, outra letra minuscula, letra maiuscula, espaco, quebra de linha e demais caracteres
+*/
+int contexto_caractere (unsigned char c)
+{
+    if (c=='a' || c=='e' || c=='i' || c=='o' || c=='u')
+    {
+        return 0;
+    }
+    if (c >= 'a' && c <= 'z')
+    {
+        return 1;
+    }
+    if (c >= 'A' && c <= 'Z')
+    {
+        return 2;
+    }
+    if (c == ' ')
+    {
+        return 3;
+    }
+    if (c == '\n' || c == '\r')
+    {
+        return 4;
+    }
+    return 5;
+}
+/**
+* Funcao Caracteres Invalidos
+* @brief Retorna quantos dos @param n caracteres de @param dados nao podem ser codificados, isto e, o caractere nulo e os de fora da tabela ASCII
+*/
+int caracteres_invalidos (const unsigned char* dados, int n)
+{
+    int i, invalidos = 0;
+    for (i=0; i<n; i++)
+    {
+        invalidos += (unsigned char) (dados[i] - 1) >= TOTSIM-1;
+    }
+    return invalidos;
+}
+/**
+* Funcao Atualizar Historico
+* @brief Guarda no estado @param e o histograma dos @param n caracteres de @param dados restaurados pelo descompressor
+* O compressor coleta o mesmo histograma durante a codificacao (@see codificar_e_contar), sem uma leitura a mais do bloco
+*/
+void atualizar_historico (EstadoFluxo* e, const unsigned char* dados, int n)
+{
+    int i;
+    memset(e->frequencias, 0, sizeof(e->frequencias));
+    for (i=0; i<n; i++)
+    {
+        e->frequencias[dados[i]]++;
+    }
+}
+/**
+* Funcao Montar Tabela do Registro
+* @brief Monta a tabela gravada em um registro a partir do histograma @param frequencias, devolvendo os codigos em @param codigos
+* As frequencias sao ajustadas para caberem em 16 bits e para terem ao menos dois caracteres, ja que uma arvore de uma unica folha nao tem codigo.
+* Ao final, @param frequencias contem exatamente as frequencias que montam a arvore, que sao as gravadas no registro
+*/
+void montar_tabela_registro (Huffman* h, int frequencias[TOTSIM], CodigoHuffman codigos[256])
+{
+    char tabela[TOTSIM][MIN];
+    int i, presentes = 0, maior = 0;
+    frequencias[0] = 0;
+    for (i=1; i<TOTSIM; i++)
+    {
+        if (frequencias[i] > 0)
+        {
+            presentes++;
+        }
+        if (frequencias[i] > maior)
+        {
+            maior = frequencias[i];
+        }
+    }
+    for (i=1; i<TOTSIM && presentes<2; i++)
+    {
+        if (frequencias[i] == 0)
+        {
+            frequencias[i] = 1;
+            presentes++;
+        }
+    }
+    while (maior > 0xFFFF)
+    {
+        maior = 0;
+        for (i=1; i<TOTSIM; i++)
+        {
+            if (frequencias[i] > 0)
+            {
+                frequencias[i] = (frequencias[i] + 1) / 2;
+            }
+            if (frequencias[i] > maior)
+            {
+                maior = frequencias[i];
+            }
+        }
+    }
+    montar_tabela_limitada(h, frequencias, tabela, BITS_MAXIMOS);
+    memcpy(frequencias, h->frequencia_letras, TOTSIM*sizeof(int));
+    montar_codigos(tabela, codigos);
+}
+/**
+* Funcao Custo dos Codigos
+* @brief Retorna quantos bits os caracteres do histograma @param frequencias ocupam com os codigos @param codigos, ou -1 caso algum deles nao tenha codigo
+*/
+long long custo_codigos (const int frequencias[], const CodigoHuffman codigos[256])
+{
+    long long custo = 0;
+    int i;
+    for (i=0; i<TOTSIM; i++)
+    {
+        if (frequencias[i] > 0 && codigos[i].tamanho == 0)
+        {
+            return -1;
+        }
+        custo += (long long) frequencias[i] * codigos[i].tamanho;
+    }
+    return custo;
+}
+/**
+* Funcao Gravar Tabela do Fluxo
+* @brief Grava em @param destino as frequencias @param frequencias: a quantidade de caracteres presentes (1 byte) e, para cada um, o caractere
+* (1 byte) e a frequencia (2 bytes). Retorna a quantidade de bytes gravados
+*/
+int gravar_tabela_fluxo (unsigned char* destino, const int frequencias[TOTSIM])
+{
+    int i, posicao = 1;
+    destino[0] = 0;
+    for (i=1; i<TOTSIM; i++)
+    {
+        if (frequencias[i] > 0)
+        {
+            destino[posicao] = (unsigned char) i;
+            gravar_inteiro_vetor(destino + posicao + 1, frequencias[i], 2);
+            posicao += 3;
+            destino[0]++;
+        }
+    }
+    return posicao;
+}
+/**
+* Funcao Ler Tabela do Fluxo
+* @brief Le de @param origem, com @param disponivel bytes, as frequencias gravadas por @see gravar_tabela_fluxo
+* Retorna a quantidade de bytes lidos ou -1 caso a tabela seja invalida
+*/
+int ler_tabela_fluxo (const unsigned char* origem, long disponivel, int frequencias[TOTSIM])
+{
+    int i, quantidade, simbolo;
+    if (disponivel < 1)
+    {
+        return -1;
+    }
+    quantidade = origem[0];
+    if (quantidade < 2 || quantidade >= TOTSIM || disponivel < 1 + 3*quantidade)
+    {
+        return -1;
+    }
+    memset(frequencias, 0, TOTSIM*sizeof(int));
+    for (i=0; i<quantidade; i++)
+    {
+        simbolo = origem[1 + 3*i];
+        if (simbolo == 0 || simbolo >= TOTSIM || frequencias[simbolo] != 0)
+        {
+            return -1;
+        }
+        frequencias[simbolo] = (int) ler_inteiro_vetor(origem + 2 + 3*i, 2);
+        if (frequencias[simbolo] == 0)
+        {
+            return -1;
+        }
+    }
+    return 1 + 3*quantidade;
+}
+/**
+* Funcao Guardar Tabela Recente
+* @brief Coloca a tabela de frequencias @param frequencias e codigos @param codigos na frente das tabelas recentes do estado @param e, descartando a mais antiga
+* O descompressor passa NULL em @param codigos, ja que apenas monta a arvore novamente a partir das frequencias
+*/
+void guardar_recente (EstadoFluxo* e, const int frequencias[TOTSIM], const CodigoHuffman codigos[256])
+{
+    int k;
+    for (k = (e->quantidade_recentes < RECENTES ? e->quantidade_recentes : RECENTES-1); k > 0; k--)
+    {
+        e->recentes[k] = e->recentes[k-1];
+    }
+    memcpy(e->recentes[0].frequencias, frequencias, TOTSIM*sizeof(int));
+    if (codigos != NULL)
+    {
+        memcpy(e->recentes[0].codigos, codigos, 256*sizeof(CodigoHuffman));
+    }
+    if (e->quantidade_recentes < RECENTES)
+    {
+        e->quantidade_recentes++;
+    }
+}
+/**
+* Funcao Codificar com Contexto
+* @brief Equivalente a @see codificar_simbolos, mas escolhendo para cada caractere os codigos do contexto do caractere anterior (@see contexto_caractere)
+* O primeiro caractere tem como contexto a quebra de linha
+*/
+void codificar_contexto (EscritorBits* e, const unsigned char* simbolos, int n, CodigoHuffman codigos[][256])
+{
+    unsigned long long acumulador = e->acumulador;
+    unsigned char* saida = e->saida;
+    int bits = e->bits, i, contexto = contexto_caractere('\n');
+    const CodigoHuffman* c;
+    for (i=0; i<n; i++)
+    {
+        c = &codigos[contexto][simbolos[i]];
+        acumulador |= c->bits >> bits;
+        bits += c->tamanho;
+        saida = descarregar_bits(saida, &acumulador, &bits);
+        contexto = contexto_caractere(simbolos[i]);
+    }
+    e->acumulador = acumulador;
+    e->bits = bits;
+    e->saida = saida;
+}
+/**
+* Funcao Decodificar com Contexto
+* @brief Equivalente a @see decodificar_bloco, mas percorrendo para cada caractere a arvore do contexto do caractere anterior, dentre as de @param raizes
+*/
+int decodificar_contexto (No* raizes[CONTEXTOS], const unsigned char* entrada, long tamanho, unsigned char* saida, int n)
+{
+    No* p = raizes[contexto_caractere('\n')];
+    long posicao = 0, fim = 8*tamanho;
+    int k = 0;
+    while (k < n)
+    {
+        if (posicao >= fim)
+        {
+            return 0;
+        }
+        p = ((entrada[posicao >> 3] >> (7 - (posicao & 7))) & 1) ? p->filhodir : p->filhoesq;
+        posicao++;
+        if (p->filhoesq == NULL)
+        {
+            saida[k] = (unsigned char) p->letra;
+            p = raizes[contexto_caractere(saida[k])];
+            k++;
+        }
+    }
+    return 1;
+}
+/**
+* Funcao Emitir Registro Cru
+* @brief Grava em @param destino um registro BLOCO_CRU com os @param n caracteres de @param dados e retorna o seu tamanho
+*/
+long emitir_cru (EstadoFluxo* e, const unsigned char* dados, int n, unsigned char* destino)
+{
+    e->registros_crus++;
+    destino[0] = BLOCO_CRU;
+    gravar_inteiro_vetor(destino + 1, n, 4);
+    memcpy(destino + 5, dados, n);
+    return 5 + n;
+}
+/**
+* Funcao Fechar Registro
+* @brief Completa o registro codificado iniciado em @param destino, cujos dados comecam na posicao @param inicio, a partir do escritor @param w
+* Grava o tamanho dos dados antes deles e retorna o tamanho do registro, ou -1 caso o registro nao seja menor que o registro cru equivalente
+*/
+long fechar_registro (EscritorBits* w, unsigned char* destino, long inicio, int n)
+{
+    long tamanho = (long) (w->saida - (destino + inicio));
+    if (w->bits > 0)
+    {
+        tamanho++;
+    }
+    if (inicio + tamanho >= 5 + n)
+    {
+        return -1;
+    }
+    gravar_inteiro_vetor(destino + inicio - 4, tamanho, 4);
+    return inicio + tamanho;
+}
+/**
+* Funcao Emitir Registro Rapido
+* @brief Codifica os @param n caracteres de @param dados no nivel rapido, gravando o registro em @param destino e retornando o seu tamanho
+* O registro e lido uma unica vez: a tabela vem do histograma do registro anterior (@see preparar_bloco), sem que nenhuma tabela seja gravada, e o
+* histograma do proprio registro e coletado durante a codificacao (@see codificar_e_contar). A tabela e repetida nos registros seguintes enquanto
+* os bits por caractere nao crescerem mais que TOLERANCIA_RAPIDO em relacao ao primeiro registro que a usou. Uma tabela montada a partir de um
+* histograma vazio, como a do primeiro registro, nunca e repetida. Registros com caracteres fora da tabela ou que nao diminuem sao gravados crus
+*/
+long emitir_rapido (EstadoFluxo* e, const unsigned char* dados, int n, unsigned char* destino)
+{
+    char tabela[TOTSIM][MIN];
+    EscritorBits w;
+    long tamanho;
+    int i, contados = 0, invalidos;
+    if (!e->atual_valido || e->ultimo > e->referencia*TOLERANCIA_RAPIDO)
+    {
+        for (i=0; i<256; i++)
+        {
+            contados += e->frequencias[i];
+        }
+        preparar_bloco(e->h, e->frequencias, tabela, BITS_RAPIDO);
+        montar_codigos(tabela, e->codigos);
+        e->referencia = -1;
+        e->tabelas_montadas++;
+        destino[0] = BLOCO_ANTERIOR;
+    }
+    else
+    {
+        contados = 1;
+        destino[0] = BLOCO_REPETIDO;
+    }
+    gravar_inteiro_vetor(destino + 1, n, 4);
+    memset(e->frequencias, 0, sizeof(e->frequencias));
+    iniciar_escritor(&w, destino + 9);
+    codificar_e_contar(&w, dados, n, e->codigos, e->frequencias);
+    invalidos = e->frequencias[0];
+    for (i=TOTSIM; i<256; i++)
+    {
+        invalidos += e->frequencias[i];
+    }
+    tamanho = invalidos > 0 ? -1 : fechar_registro(&w, destino, 9, n);
+    if (tamanho < 0)
+    {
+        e->atual_valido = 0;
+        return emitir_cru(e, dados, n, destino);
+    }
+    e->atual_valido = contados > 0;
+    e->ultimo = 8.0*(tamanho - 9)/n;
+    if (e->referencia < 0)
+    {
+        e->referencia = e->ultimo;
+    }
+    return tamanho;
+}
+/**
+* Funcao Emitir Registro com Tabela
+* @brief Codifica os @param n caracteres de @param dados com uma tabela propria, gravando o registro em @param destino e retornando o seu tamanho
+* No nivel padrao a tabela e sempre montada a partir do proprio registro. Com @param busca verdadeiro, como no nivel melhor, tambem sao estimados
+* o custo de reusar cada tabela recente e o custo de uma tabela por contexto de ordem 1, e a opcao de menor custo estimado e a gravada
+*/
+long emitir_tabela (EstadoFluxo* e, const unsigned char* dados, int n, unsigned char* destino, int busca)
+{
+    int histograma[256];
+    int nova[TOTSIM];
+    int contextos[CONTEXTOS][TOTSIM];
+    CodigoHuffman codigos_nova[256];
+    CodigoHuffman codigos_contexto[CONTEXTOS][256];
+    CodigoHuffman* codigos;
+    long long custo, melhor;
+    long posicao, tamanho;
+    int i, k, escolha = -1, contexto, bytes_tabela;
+    unsigned char tabelas[CONTEXTOS*(1 + 3*TOTSIM)];
+    EscritorBits w;
+    memset(histograma, 0, sizeof(histograma));
+    for (i=0; i<n; i++)
+    {
+        histograma[dados[i]]++;
+    }
+    if (caracteres_invalidos(dados, n) > 0)
+    {
+        return emitir_cru(e, dados, n, destino);
+    }
+    memcpy(nova, histograma, sizeof(nova));
+    montar_tabela_registro(e->h, nova, codigos_nova);
+    bytes_tabela = gravar_tabela_fluxo(tabelas, nova);
+    melhor = custo_codigos(histograma, codigos_nova) + 8*bytes_tabela;
+    if (busca)
+    {
+        for (k=0; k<e->quantidade_recentes; k++)
+        {
+            custo = custo_codigos(histograma, e->recentes[k].codigos);
+            if (custo >= 0 && custo + 8 < melhor)
+            {
+                melhor = custo + 8;
+                escolha = k;
+            }
+        }
+        memset(contextos, 0, sizeof(contextos));
+        contexto = contexto_caractere('\n');
+        for (i=0; i<n; i++)
+        {
+            contextos[contexto][dados[i]]++;
+            contexto = contexto_caractere(dados[i]);
+        }
+        custo = 0;
+        for (k=0; k<CONTEXTOS; k++)
+        {
+            int ajustadas[TOTSIM];
+            memcpy(ajustadas, contextos[k], sizeof(ajustadas));
+            montar_tabela_registro(e->h, ajustadas, codigos_contexto[k]);
+            custo += custo_codigos(contextos[k], codigos_contexto[k]);
+            memcpy(contextos[k], ajustadas, sizeof(ajustadas));
+        }
+        posicao = 0;
+        for (k=0; k<CONTEXTOS; k++)
+        {
+            posicao += gravar_tabela_fluxo(tabelas + posicao, contextos[k]);
+        }
+        if (custo + 8*posicao < melhor)
+        {
+            melhor = custo + 8*posicao;
+            escolha = RECENTES;
+        }
+    }
+    gravar_inteiro_vetor(destino + 1, n, 4);
+    if (escolha == RECENTES)
+    {
+        destino[0] = BLOCO_CONTEXTO;
+        memcpy(destino + 5, tabelas, posicao);
+        posicao += 5 + 4;
+        iniciar_escritor(&w, destino + posicao);
+        codificar_contexto(&w, dados, n, codigos_contexto);
+        tamanho = fechar_registro(&w, destino, posicao, n);
+        if (tamanho < 0)
+        {
+            return emitir_cru(e, dados, n, destino);
+        }
+        e->tabelas_montadas += CONTEXTOS;
+        return tamanho;
+    }
+    if (escolha >= 0)
+    {
+        destino[0] = BLOCO_REUSO;
+        destino[5] = (unsigned char) escolha;
+        posicao = 5 + 1 + 4;
+        codigos = e->recentes[escolha].codigos;
+    }
+    else
+    {
+        destino[0] = BLOCO_TABELA;
+        posicao = 5 + gravar_tabela_fluxo(destino + 5, nova) + 4;
+        codigos = codigos_nova;
+    }
+    iniciar_escritor(&w, destino + posicao);
+    codificar_simbolos(&w, dados, n, codigos);
+    tamanho = fechar_registro(&w, destino, posicao, n);
+    if (tamanho < 0)
+    {
+        return emitir_cru(e, dados, n, destino);
+    }
+    if (escolha < 0)
+    {
+        guardar_recente(e, nova, codigos_nova);
+        e->tabelas_montadas++;
+    }
+    return tamanho;
+}
+/**
+* Funcao Custo Estimado
+* @brief Estima quantos bits ocupa o registro que guarda os caracteres do histograma @param histograma, que tem @param n caracteres
+* Considera uma tabela propria e o reuso das tabelas recentes, alem do cabecalho do registro. Caso haja caracteres invalidos, o custo e o do registro cru
+*/
+long long custo_estimado (EstadoFluxo* e, const int histograma[256], int n)
+{
+    int nova[TOTSIM];
+    CodigoHuffman codigos[256];
+    unsigned char tabela[1 + 3*TOTSIM];
+    long long custo, melhor;
+    int i, k;
+    for (i=TOTSIM; i<256 && histograma[i]==0; i++);
+    if (histograma[0] > 0 || i < 256)
+    {
+        return 8*(5 + (long long) n);
+    }
+    memcpy(nova, histograma, sizeof(nova));
+    montar_tabela_registro(e->h, nova, codigos);
+    melhor = custo_codigos(histograma, codigos) + 8*gravar_tabela_fluxo(tabela, nova);
+    for (k=0; k<e->quantidade_recentes; k++)
+    {
+        custo = custo_codigos(histograma, e->recentes[k].codigos);
+        if (custo >= 0 && custo + 8 < melhor)
+        {
+            melhor = custo + 8;
+        }
+    }
+    return melhor + 8*9;
+}
+/**
+* Funcao Dividir Bloco
+* @brief Escolhe como dividir os @param n caracteres de @param dados em registros, preenchendo @param cortes com as posicoes de inicio de cada um
+* O bloco e dividido em segmentos de TAMANHO_SEGMENTO caracteres e, por programacao dinamica, e escolhida a sequencia de registros de segmentos
+* consecutivos com o menor custo estimado (@see custo_estimado). Retorna a quantidade de registros; @param cortes recebe tambem o fim do bloco
+*/
+int dividir_bloco (EstadoFluxo* e, const unsigned char* dados, int n, int cortes[])
+{
+    int prefixos[TAMANHO_BLOCO/TAMANHO_SEGMENTO + 1][256];
+    long long custo[TAMANHO_BLOCO/TAMANHO_SEGMENTO + 1], c;
+    int origem[TAMANHO_BLOCO/TAMANHO_SEGMENTO + 1];
+    int histograma[256];
+    int segmentos = (n + TAMANHO_SEGMENTO - 1) / TAMANHO_SEGMENTO;
+    int i, j, k, fim, quantidade;
+    memset(prefixos[0], 0, sizeof(prefixos[0]));
+    for (j=1; j<=segmentos; j++)
+    {
+        memcpy(prefixos[j], prefixos[j-1], sizeof(prefixos[j]));
+        fim = j*TAMANHO_SEGMENTO < n ? j*TAMANHO_SEGMENTO : n;
+        for (i=(j-1)*TAMANHO_SEGMENTO; i<fim; i++)
+        {
+            prefixos[j][dados[i]]++;
+        }
+    }
+    custo[0] = 0;
+    for (j=1; j<=segmentos; j++)
+    {
+        custo[j] = -1;
+        for (i=0; i<j; i++)
+        {
+            for (k=0; k<256; k++)
+            {
+                histograma[k] = prefixos[j][k] - prefixos[i][k];
+            }
+            fim = j*TAMANHO_SEGMENTO < n ? j*TAMANHO_SEGMENTO : n;
+            c = custo[i] + custo_estimado(e, histograma, fim - i*TAMANHO_SEGMENTO);
+            if (custo[j] < 0 || c < custo[j])
+            {
+                custo[j] = c;
+                origem[j] = i;
+            }
+        }
+    }
+    quantidade = 0;
+    for (j=segmentos; j>0; j=origem[j])
+    {
+        quantidade++;
+    }
+    cortes[quantidade] = n;
+    for (j=segmentos, k=quantidade-1; j>0; j=origem[j], k--)
+    {
+        cortes[k] = origem[j]*TAMANHO_SEGMENTO;
+    }
+    return quantidade;
+}
+/**
+* Funcao Codificar Bloco do Fluxo
+* @brief Codifica os @param n caracteres de @param dados no nivel do estado @param e, gravando um ou mais registros em @param destino
+* Retorna a quantidade de bytes gravados
+*/
+long codificar_bloco_fluxo (EstadoFluxo* e, const unsigned char* dados, int n, unsigned char* destino)
+{
+    int cortes[TAMANHO_BLOCO/TAMANHO_SEGMENTO + 1];
+    int k, quantidade;
+    long total = 0;
+    if (e->nivel == NIVEL_RAPIDO)
+    {
+        return emitir_rapido(e, dados, n, destino);
+    }
+    if (e->nivel == NIVEL_PADRAO)
+    {
+        return emitir_tabela(e, dados, n, destino, 0);
+    }
+    quantidade = dividir_bloco(e, dados, n, cortes);
+    for (k=0; k<quantidade; k++)
+    {
+        total += emitir_tabela(e, dados + cortes[k], cortes[k+1] - cortes[k], destino + total, 1);
+    }
+    return total;
+}
+/**
+* Funcao Ler Registro
+* @brief Le do arquivo @param arq o restante de um registro do tipo @param tipo com @param n caracteres, isto e, tudo que segue o tipo e a
+* quantidade de caracteres, guardando em @param destino. Retorna a quantidade de bytes lidos ou -1 caso o registro seja invalido
+*/
+long ler_registro (FILE* arq, int tipo, int n, unsigned char* destino)
+{
+    long posicao = 0, tamanho;
+    int k, c, tabelas = 0;
+    if (tipo == BLOCO_CRU)
+    {
+        return fread(destino, sizeof(unsigned char), n, arq) == (size_t) n ? n : -1;
+    }
+    if (tipo == BLOCO_TABELA)
+    {
+        tabelas = 1;
+    }
+    else if (tipo == BLOCO_CONTEXTO)
+    {
+        tabelas = CONTEXTOS;
+    }
+    else if (tipo == BLOCO_REUSO)
+    {
+        if ((c = fgetc(arq)) == EOF)
+        {
+            return -1;
+        }
+        destino[posicao++] = (unsigned char) c;
+    }
+    else if (tipo != BLOCO_ANTERIOR && tipo != BLOCO_REPETIDO)
+    {
+        return -1;
+    }
+    for (k=0; k<tabelas; k++)
+    {
+        if ((c = fgetc(arq)) == EOF || c >= TOTSIM)
+        {
+            return -1;
+        }
+        destino[posicao++] = (unsigned char) c;
+        if (fread(destino + posicao, sizeof(unsigned char), 3*c, arq) != (size_t) (3*c))
+        {
+            return -1;
+        }
+        posicao += 3*c;
+    }
+    if (fread(destino + posicao, sizeof(unsigned char), 4, arq) != 4)
+    {
+        return -1;
+    }
+    tamanho = (long) ler_inteiro_vetor(destino + posicao, 4);
+    posicao += 4;
+    if (tamanho <= 0 || tamanho > 3*TAMANHO_BLOCO || fread(destino + posicao, sizeof(unsigned char), tamanho, arq) != (size_t) tamanho)
+    {
+        return -1;
+    }
+    return posicao + tamanho;
+}
+/**
+* Funcao Decodificar Registro
+* @brief Restaura em @param saida os @param n caracteres do registro do tipo @param tipo lido por @see ler_registro em @param registro
+* Monta as mesmas arvores que o compressor montou para o registro, a partir das tabelas gravadas ou do estado @param e. Retorna 1 em caso de
+* sucesso e 0 caso o registro seja invalido
+*/
+int decodificar_registro (EstadoFluxo* e, int tipo, const unsigned char* registro, long tamanho, unsigned char* saida, int n)
+{
+    char tabela[TOTSIM][MIN];
+    int frequencias[TOTSIM];
+    No* raizes[CONTEXTOS];
+    long posicao = 0, dados;
+    int k, lidos, sucesso = 1;
+    if (tipo == BLOCO_CRU)
+    {
+        memcpy(saida, registro, n);
+        atualizar_historico(e, saida, n);
+        e->registros_crus++;
+        return 1;
+    }
+    if (tipo != BLOCO_REPETIDO)
+    {
+        e->tabelas_montadas += tipo == BLOCO_CONTEXTO ? CONTEXTOS : 1;
+    }
+    if (tipo == BLOCO_ANTERIOR)
+    {
+        preparar_bloco(e->h, e->frequencias, tabela, BITS_RAPIDO);
+        liberar_nos(e->atual);
+        e->atual = destacar_arvore(e->h);
+    }
+    else if (tipo == BLOCO_TABELA)
+    {
+        if ((lidos = ler_tabela_fluxo(registro, tamanho, frequencias)) < 0)
+        {
+            return 0;
+        }
+        posicao = lidos;
+        montar_tabela_limitada(e->h, frequencias, tabela, BITS_MAXIMOS);
+        liberar_nos(e->atual);
+        e->atual = destacar_arvore(e->h);
+        guardar_recente(e, frequencias, NULL);
+    }
+    else if (tipo == BLOCO_REUSO)
+    {
+        if (registro[0] >= e->quantidade_recentes)
+        {
+            return 0;
+        }
+        posicao = 1;
+        montar_tabela_limitada(e->h, e->recentes[registro[0]].frequencias, tabela, BITS_MAXIMOS);
+        liberar_nos(e->atual);
+        e->atual = destacar_arvore(e->h);
+    }
+    else if (tipo == BLOCO_CONTEXTO)
+    {
+        for (k=0; k<CONTEXTOS; k++)
+        {
+            raizes[k] = NULL;
+        }
+        for (k=0; k<CONTEXTOS && sucesso; k++)
+        {
+            if ((lidos = ler_tabela_fluxo(registro + posicao, tamanho - posicao, frequencias)) < 0)
+            {
+                sucesso = 0;
+            }
+            else
+            {
+                posicao += lidos;
+                montar_tabela_limitada(e->h, frequencias, tabela, BITS_MAXIMOS);
+                raizes[k] = destacar_arvore(e->h);
+            }
+        }
+        dados = sucesso ? (long) ler_inteiro_vetor(registro + posicao, 4) : 0;
+        sucesso = sucesso && posicao + 4 + dados <= tamanho &&
+                  decodificar_contexto(raizes, registro + posicao + 4, dados, saida, n);
+        for (k=0; k<CONTEXTOS; k++)
+        {
+            liberar_nos(raizes[k]);
+        }
+        if (sucesso)
+        {
+            atualizar_historico(e, saida, n);
+        }
+        return sucesso;
+    }
+    else if (tipo != BLOCO_REPETIDO || e->atual == NULL)
+    {
+        return 0;
+    }
+    dados = (long) ler_inteiro_vetor(registro + posicao, 4);
+    posicao += 4;
+    if (posicao + dados > tamanho || !decodificar_bloco(e->atual, registro + posicao, dados, saida, n))
+    {
+        return 0;
+    }
+    atualizar_historico(e, saida, n);
+    return 1;
+}
+/**
+* Funcao Abrir Fluxo
+* @brief Abre o arquivo @param caminho no modo binario @param modo, ou a entrada ou saida padrao, tambem em modo binario, caso o caminho seja "-"
+*/
+FILE* abrir_fluxo (const char* caminho, const char* modo)
+{
+    if (strcmp(caminho, "-") == 0)
+    {
+        FILE* padrao = modo[0] == 'r' ? stdin : stdout;
+        _setmode(_fileno(padrao), _O_BINARY);
+        return padrao;
+    }
+    return fopen(caminho, modo);
+}
+/**
+* Defines do Pipeline
+* BLOCOS_PIPELINE representa a quantidade de blocos em circulacao entre as etapas de leitura, codificacao e escrita. Como e tambem a capacidade
+* de cada fila, nenhuma etapa bloqueia por falta de espaco na fila seguinte, apenas por falta de blocos livres
+*/
+#define BLOCOS_PIPELINE 4
+
+/**
+* Struct Bloco do Fluxo
+* @brief Consiste em um bloco em circulacao no pipeline, com os vetores do texto original e do texto codificado, reaproveitados a cada uso
+*/
+typedef struct BlocoFluxo
+{
+    unsigned char* dados; /**< Caracteres originais do bloco*/
+    unsigned char* codificado; /**< Registros gravados para o bloco na compressao, ou o conteudo do registro lido na descompressao*/
+    int n; /**< Quantidade de caracteres do bloco, zero no bloco que indica o fim do fluxo e negativo em um bloco a ser descartado*/
+    long tamanho; /**< Quantidade de bytes em codificado*/
+    int tipo; /**< Tipo do registro lido na descompressao*/
+} BlocoFluxo;
+
+/**
+* Struct Fila
+* @brief Consiste em uma fila circular limitada de blocos, na qual a insercao espera por uma vaga e a retirada espera por um bloco
+*/
+typedef struct Fila
+{
+    BlocoFluxo* itens[BLOCOS_PIPELINE]; /**< Blocos da fila, a partir da posicao inicio*/
+    int inicio; /**< Posicao do primeiro bloco da fila*/
+    int quantidade; /**< Quantidade de blocos na fila*/
+    HANDLE vagas; /**< Semaforo com a quantidade de posicoes livres*/
+    HANDLE ocupadas; /**< Semaforo com a quantidade de blocos na fila*/
+    CRITICAL_SECTION secao; /**< Protege inicio e quantidade*/
+    Estatisticas* estatisticas; /**< Contadores em que a quantidade de blocos e registrada, ou NULL*/
+    int indice; /**< Fila correspondente nos contadores: FILA_LIVRES, FILA_CHEIOS ou FILA_PRONTOS*/
+} Fila;
+
+/**
+* Struct Pipeline
+* @brief Consiste no estado compartilhado pelas threads de leitura, codificacao e escrita de um fluxo
+* Os blocos saem da fila de livres para a leitura, seguem para a codificacao pela fila de cheios, para a escrita pela fila de prontos e entao
+* voltam a fila de livres
+*/
+typedef struct Pipeline
+{
+    FILE* entrada; /**< Arquivo lido pela thread de leitura*/
+    FILE* saida; /**< Arquivo gravado pela thread de escrita*/
+    Fila livres; /**< Blocos disponiveis para a leitura*/
+    Fila cheios; /**< Blocos lidos aguardando a codificacao*/
+    Fila prontos; /**< Blocos codificados aguardando a escrita*/
+    BlocoFluxo blocos[BLOCOS_PIPELINE]; /**< Todos os blocos do pipeline*/
+    int erro; /**< Indica que o fluxo comprimido lido e invalido, preenchido pela etapa de codificacao ao terminar*/
+    int nivel; /**< Nivel de compressao usado pela etapa de codificacao da compressao*/
+    long long lidos; /**< Quantidade de bytes lidos da entrada*/
+    long long gravados; /**< Quantidade de bytes gravados na saida*/
+    Estatisticas* estatisticas; /**< Contadores da execucao, ou NULL caso as estatisticas estejam desligadas*/
+} Pipeline;
+
+/**
+* Funcao Iniciar Fila
+* @brief Prepara a fila @param f vazia, com BLOCOS_PIPELINE vagas, registrando a sua quantidade de blocos como a fila @param indice de @param s
+*/
+void iniciar_fila (Fila* f, Estatisticas* s, int indice)
+{
+    f->inicio = 0;
+    f->quantidade = 0;
+    f->estatisticas = s;
+    f->indice = indice;
+    f->vagas = CreateSemaphoreA(NULL, BLOCOS_PIPELINE, BLOCOS_PIPELINE, NULL);
+    f->ocupadas = CreateSemaphoreA(NULL, 0, BLOCOS_PIPELINE, NULL);
+    if (f->vagas == NULL || f->ocupadas == NULL)
+    {
+        puts("Nao foi possivel criar as filas!");
+        exit(1);
+    }
+    InitializeCriticalSection(&f->secao);
+}
+/**
+* Funcao Inserir na Fila
+* @brief Insere o bloco @param b no fim da fila @param f, esperando por uma vaga caso ela esteja cheia
+*/
+void inserir_fila (Fila* f, BlocoFluxo* b)
+{
+    WaitForSingleObject(f->vagas, INFINITE);
+    EnterCriticalSection(&f->secao);
+    f->itens[(f->inicio + f->quantidade) % BLOCOS_PIPELINE] = b;
+    f->quantidade++;
+    registrar_fila(f->estatisticas, f->indice, f->quantidade);
+    LeaveCriticalSection(&f->secao);
+    ReleaseSemaphore(f->ocupadas, 1, NULL);
+}
+/**
+* Funcao Retirar da Fila
+* @brief Retira e retorna o primeiro bloco da fila @param f, esperando por um bloco caso ela esteja vazia
+*/
+BlocoFluxo* retirar_fila (Fila* f)
+{
+    BlocoFluxo* b;
+    WaitForSingleObject(f->ocupadas, INFINITE);
+    EnterCriticalSection(&f->secao);
+    b = f->itens[f->inicio];
+    f->inicio = (f->inicio + 1) % BLOCOS_PIPELINE;
+    f->quantidade--;
+    registrar_fila(f->estatisticas, f->indice, f->quantidade);
+    LeaveCriticalSection(&f->secao);
+    ReleaseSemaphore(f->vagas, 1, NULL);
+    return b;
+}
+/**
+* Funcao Destruir Fila
+* @brief Devolve os recursos do sistema usados pela fila @param f
+*/
+void destruir_fila (Fila* f)
+{
+    CloseHandle(f->vagas);
+    CloseHandle(f->ocupadas);
+    DeleteCriticalSection(&f->secao);
+}
+/**
+* Funcao Iniciar Pipeline
+* @brief Prepara o pipeline @param p entre @param entrada e @param saida, alocando os blocos e colocando todos na fila de livres
+* As etapas registram os seus contadores em @param s, que pode ser NULL
+*/
+void iniciar_pipeline (Pipeline* p, FILE* entrada, FILE* saida, Estatisticas* s)
+{
+    int i;
+    p->entrada = entrada;
+    p->saida = saida;
+    p->erro = 0;
+    p->lidos = 0;
+    p->gravados = 0;
+    p->estatisticas = s;
+    iniciar_fila(&p->livres, s, FILA_LIVRES);
+    iniciar_fila(&p->cheios, s, FILA_CHEIOS);
+    iniciar_fila(&p->prontos, s, FILA_PRONTOS);
+    for (i=0; i<BLOCOS_PIPELINE; i++)
+    {
+        p->blocos[i].dados = (unsigned char*) malloc(TAMANHO_BLOCO);
+        p->blocos[i].codificado = (unsigned char*) malloc(TAMANHO_CODIFICADO);
+        if (p->blocos[i].dados == NULL || p->blocos[i].codificado == NULL)
+        {
+            puts("Memoria insuficiente!");
+            exit(1);
+        }
+        inserir_fila(&p->livres, &p->blocos[i]);
+    }
+}
+/**
+* Funcao Executar Pipeline
+* @brief Executa as etapas de leitura @param leitura e escrita @param escrita em threads proprias e a etapa de codificacao @param codificacao
+* na thread atual, retornando quando as tres terminarem. Ao final, os blocos e as filas do pipeline @param p sao liberados
+*/
+void executar_pipeline (Pipeline* p, LPTHREAD_START_ROUTINE leitura, void (*codificacao)(Pipeline*), LPTHREAD_START_ROUTINE escrita)
+{
+    HANDLE threads[2];
+    int i;
+    threads[0] = CreateThread(NULL, 0, leitura, p, 0, NULL);
+    threads[1] = CreateThread(NULL, 0, escrita, p, 0, NULL);
+    if (threads[0] == NULL || threads[1] == NULL)
+    {
+        puts("Nao foi possivel criar as threads!");
+        exit(1);
+    }
+    codificacao(p);
+    WaitForMultipleObjects(2, threads, TRUE, INFINITE);
+    CloseHandle(threads[0]);
+    CloseHandle(threads[1]);
+    destruir_fila(&p->livres);
+    destruir_fila(&p->cheios);
+    destruir_fila(&p->prontos);
+    for (i=0; i<BLOCOS_PIPELINE; i++)
+    {
+        free(p->blocos[i].dados);
+        free(p->blocos[i].codificado);
+    }
+}
+/**
+* Funcao Ler Blocos para Compressao
+* @brief Etapa de leitura da compressao: preenche os blocos livres com ate TAMANHO_BLOCO caracteres da entrada
+* O fim da entrada e sinalizado por um bloco vazio
+*/
+DWORD WINAPI ler_blocos_compressao (LPVOID parametro)
+{
+    Pipeline* p = (Pipeline*) parametro;
+    BlocoFluxo* b;
+    LONGLONG inicio;
+    int n;
+    do
+    {
+        b = retirar_fila(&p->livres);
+        inicio = relogio();
+        n = b->n = (int) fread(b->dados, sizeof(unsigned char), TAMANHO_BLOCO, p->entrada);
+        p->lidos += n;
+        registrar_latencia(p->estatisticas, ETAPA_LEITURA, inicio);
+        somar_bytes(p->estatisticas, n, 0);
+        inserir_fila(&p->cheios, b);
+    }
+    while (n > 0);
+    return 0;
+}
+/**
+* Funcao Codificar Blocos
+* @brief Etapa de codificacao da compressao: grava em cada bloco os registros que o representam no nivel do pipeline (@see codificar_bloco_fluxo)
+*/
+void codificar_blocos (Pipeline* p)
+{
+    EstadoFluxo e;
+    BlocoFluxo* b;
+    LONGLONG inicio;
+    iniciar_estado_fluxo(&e, p->nivel);
+    while ((b = retirar_fila(&p->cheios))->n > 0)
+    {
+        inicio = relogio();
+        b->tamanho = codificar_bloco_fluxo(&e, b->dados, b->n, b->codificado);
+        registrar_latencia(p->estatisticas, ETAPA_CODIFICACAO, inicio);
+        publicar_estado(p->estatisticas, &e);
+        inserir_fila(&p->prontos, b);
+    }
+    inserir_fila(&p->prontos, b);
+    liberar_estado_fluxo(&e);
+}
+/**
+* Funcao Escrever Blocos da Compressao
+* @brief Etapa de escrita da compressao: grava a assinatura, os registros de cada bloco e, no bloco vazio, o marcador de fim
+*/
+DWORD WINAPI escrever_blocos_compressao (LPVOID parametro)
+{
+    Pipeline* p = (Pipeline*) parametro;
+    BlocoFluxo* b;
+    LONGLONG inicio;
+    fwrite(ASSINATURA_FLUXO, sizeof(char), 4, p->saida);
+    p->gravados = 4;
+    somar_bytes(p->estatisticas, 0, 4);
+    while ((b = retirar_fila(&p->prontos))->n > 0)
+    {
+        inicio = relogio();
+        fwrite(b->codificado, sizeof(unsigned char), b->tamanho, p->saida);
+        p->gravados += b->tamanho;
+        registrar_latencia(p->estatisticas, ETAPA_ESCRITA, inicio);
+        somar_bytes(p->estatisticas, 0, b->tamanho);
+        inserir_fila(&p->livres, b);
+    }
+    fputc(BLOCO_FIM, p->saida);
+    p->gravados += 1;
+    somar_bytes(p->estatisticas, 0, 1);
+    return 0;
+}
+/**
+* Funcao Comprimir Fluxo
+* @brief Comprime @param entrada em @param saida lendo a entrada uma unica vez, bloco a bloco
+* A leitura, a codificacao e a escrita acontecem ao mesmo tempo, em um pipeline de tres etapas (@see ler_blocos_compressao, @see codificar_blocos
+* e @see escrever_blocos_compressao), de modo que o tempo total se aproxima do tempo da etapa mais lenta. Os totais lidos e gravados sao
+* devolvidos em @param lidos e @param gravados. O nivel de compressao @param nivel e um de NIVEL_RAPIDO, NIVEL_PADRAO ou NIVEL_MELHOR, e os
+* contadores da execucao sao registrados em @param s, que pode ser NULL
+*/
+void comprimir_fluxo (FILE* entrada, FILE* saida, int nivel, Estatisticas* s, long long* lidos, long long* gravados)
+{
+    Pipeline p;
+    iniciar_pipeline(&p, entrada, saida, s);
+    p.nivel = nivel;
+    executar_pipeline(&p, ler_blocos_compressao, codificar_blocos, escrever_blocos_compressao);
+    *lidos = p.lidos;
+    *gravados = p.gravados;
+}
+/**
+* Funcao Ler Blocos para Descompressao
+* @brief Etapa de leitura da descompressao: le o tipo, a quantidade de caracteres e o restante de cada registro do fluxo comprimido (@see ler_registro)
+* O marcador de fim e sinalizado por um bloco vazio do tipo BLOCO_FIM. Caso o fluxo seja invalido ou termine antes do marcador, o bloco vazio e
+* do tipo BLOCO_INVALIDO. A quantidade de caracteres e guardada antes de o bloco ser entregue, ja que a etapa seguinte pode altera-la
+*/
+DWORD WINAPI ler_blocos_descompressao (LPVOID parametro)
+{
+    Pipeline* p = (Pipeline*) parametro;
+    BlocoFluxo* b;
+    LONGLONG inicio;
+    int tipo, n;
+    do
+    {
+        b = retirar_fila(&p->livres);
+        inicio = relogio();
+        tipo = fgetc(p->entrada);
+        b->n = 0;
+        b->tipo = tipo == BLOCO_FIM ? BLOCO_FIM : BLOCO_INVALIDO;
+        if (tipo != EOF && tipo != BLOCO_FIM)
+        {
+            b->tipo = tipo;
+            b->n = (int) ler_inteiro(p->entrada, 4);
+            b->tamanho = (b->n > 0 && b->n <= TAMANHO_BLOCO) ? ler_registro(p->entrada, tipo, b->n, b->codificado) : -1;
+            if (b->tamanho < 0)
+            {
+                b->n = 0;
+                b->tipo = BLOCO_INVALIDO;
+            }
+            else
+            {
+                p->lidos += 5 + b->tamanho;
+                somar_bytes(p->estatisticas, 4 + b->tamanho, 0);
+            }
+        }
+        if (tipo != EOF)
+        {
+            somar_bytes(p->estatisticas, 1, 0);
+        }
+        registrar_latencia(p->estatisticas, ETAPA_LEITURA, inicio);
+        n = b->n;
+        inserir_fila(&p->cheios, b);
+    }
+    while (n > 0);
+    return 0;
+}
+/**
+* Funcao Decodificar Blocos
+* @brief Etapa de codificacao da descompressao: restaura cada bloco a partir do seu registro e do estado deixado pelos anteriores (@see decodificar_registro)
+* Depois de um registro invalido os blocos seguintes sao marcados para descarte, mas continuam sendo consumidos para que a leitura nao fique bloqueada
+*/
+void decodificar_blocos (Pipeline* p)
+{
+    EstadoFluxo e;
+    BlocoFluxo* b;
+    LONGLONG inicio;
+    int falha = 0;
+    iniciar_estado_fluxo(&e, 0);
+    while ((b = retirar_fila(&p->cheios))->n > 0)
+    {
+        inicio = relogio();
+        if (falha || !decodificar_registro(&e, b->tipo, b->codificado, b->tamanho, b->dados, b->n))
+        {
+            falha = 1;
+            b->n = -1;
+        }
+        registrar_latencia(p->estatisticas, ETAPA_CODIFICACAO, inicio);
+        publicar_estado(p->estatisticas, &e);
+        inserir_fila(&p->prontos, b);
+    }
+    p->erro = falha || b->tipo == BLOCO_INVALIDO;
+    inserir_fila(&p->prontos, b);
+    liberar_estado_fluxo(&e);
+}
+/**
+* Funcao Escrever Blocos da Descompressao
+* @brief Etapa de escrita da descompressao: grava os caracteres restaurados de cada bloco ate o bloco vazio
+*/
+DWORD WINAPI escrever_blocos_descompressao (LPVOID parametro)
+{
+    Pipeline* p = (Pipeline*) parametro;
+    BlocoFluxo* b;
+    LONGLONG inicio;
+    while ((b = retirar_fila(&p->prontos))->n != 0)
+    {
+        if (b->n > 0)
+        {
+            inicio = relogio();
+            fwrite(b->dados, sizeof(unsigned char), b->n, p->saida);
+            p->gravados += b->n;
+            registrar_latencia(p->estatisticas, ETAPA_ESCRITA, inicio);
+            somar_bytes(p->estatisticas, 0, b->n);
+        }
+        inserir_fila(&p->livres, b);
+    }
+    return 0;
+}
+/**
+* Funcao Descomprimir Fluxo
+* @brief Restaura em @param saida o fluxo comprimido por @see comprimir_fluxo lido de @param entrada
+* Usa o mesmo pipeline de tres etapas da compressao (@see ler_blocos_descompressao, @see decodificar_blocos e @see escrever_blocos_descompressao).
+* Os contadores da execucao sao registrados em @param s, que pode ser NULL. Retorna 1 em caso de sucesso e 0 caso o fluxo seja invalido ou
+* termine antes do marcador de fim
+*/
+int descomprimir_fluxo (FILE* entrada, FILE* saida, Estatisticas* s)
+{
+    Pipeline p;
+    char assinatura[5];
+    assinatura[4] = 0;
+    if (fread(assinatura, sizeof(char), 4, entrada) != 4 || strcmp(assinatura, ASSINATURA_FLUXO) != 0)
+    {
+        return 0;
+    }
+    somar_bytes(s, 4, 0);
+    iniciar_pipeline(&p, entrada, saida, s);
+    executar_pipeline(&p, ler_blocos_descompressao, decodificar_blocos, escrever_blocos_descompressao);
+    return !p.erro;
+}
+/**
+* Funcao Modo Fluxo
+* @brief Trata as linhas de comando "-fluxo [-1|-2|-3] <entrada> <saida>" e "-desfluxo <entrada> <saida>", em que "-" indica a entrada ou
+* saida padrao e o nivel opcional vai do mais rapido (-1) ao de maior compressao (-3), sendo -2 o padrao
+* Como a saida padrao pode conter o fluxo, os resultados sao impressos na saida de erros. Caso @param estatisticas nao seja NULL, os
+* contadores da execucao sao gravados periodicamente nesse arquivo (@see gravar_estatisticas)
+*/
+int modo_fluxo (int argc, char* argv[], const char* estatisticas)
+{
+    FILE* entrada;
+    FILE* saida;
+    Estatisticas contadores;
+    Estatisticas* s = NULL;
+    long long lidos, gravados;
+    int inicio, fim, nivel = NIVEL_PADRAO, compressao = strcmp(argv[1], "-fluxo") == 0;
+    if (argc == 5)
+    {
+        if (strcmp(argv[2], "-1") == 0)
+        {
+            nivel = NIVEL_RAPIDO;
+        }
+        else if (strcmp(argv[2], "-3") == 0)
+        {
+            nivel = NIVEL_MELHOR;
+        }
+        else if (strcmp(argv[2], "-2") != 0)
+        {
+            fprintf(stderr, "Nivel invalido!\n");
+            return 0;
+        }
+        argv++;
+    }
+    entrada = abrir_fluxo(argv[2], "rb");
+    if (entrada == NULL)
+    {
+        fprintf(stderr, "Arquivo nao encontrado!\n");
+        return 0;
+    }
+    saida = abrir_fluxo(argv[3], "wb");
+    if (saida == NULL)
+    {
+        fprintf(stderr, "Nao foi possivel criar o arquivo!\n");
+        if (entrada != stdin)
+        {
+            fclose(entrada);
+        }
+        return 0;
+    }
+    if (estatisticas != NULL)
+    {
+        iniciar_estatisticas(&contadores, estatisticas);
+        s = &contadores;
+    }
+    inicio = GetTickCount();
+    if (compressao)
+    {
+        comprimir_fluxo(entrada, saida, nivel, s, &lidos, &gravados);
+        fim = GetTickCount();
+        if (lidos > 0)
+        {
+            fprintf(stderr, "Porcentagem de compactacao %.2f\n", (float) (1 - (double) gravados/lidos)*100);
+        }
+    }
+    else
+    {
+        if (!descomprimir_fluxo(entrada, saida, s))
+        {
+            fprintf(stderr, "Fluxo invalido!\n");
+        }
+        fim = GetTickCount();
+    }
+    if (s != NULL)
+    {
+        encerrar_estatisticas(s);
+    }
+    fprintf(stderr, "Tempo computacional: %d\n", fim-inicio);
+    if (entrada != stdin)
+    {
+        fclose(entrada);
+    }
+    if (saida != stdout)
+    {
+        fclose(saida);
+    }
+    else
+    {
+        fflush(saida);
+    }
+    return 0;
+}
+/**
+* Funcao Principal do Codigo 
+* Caso o primeiro argumento seja "-lote", os arquivos de um diretorio ou de uma lista sao comprimidos em paralelo (@see modo_lote). Os argumentos
+* "-arquivar", "-listar" e "-extrair" tratam do arquivo de varios membros (@see modo_arquivar, @see modo_listar e @see modo_extrair), e os
+* argumentos "-fluxo" e "-desfluxo" comprimem e restauram lendo a entrada uma unica vez (@see modo_fluxo). Os modos "-lote", "-arquivar", "-fluxo"
+* e "-desfluxo" aceitam, logo depois do modo, a opcao "-estatisticas <arquivo>" (@see separar_estatisticas).
+* Primeiramente, verifica-se o numero de argumentos de entrada para assim decidir se o codigo entrar na funcao de codificacao, caso hajam tres argumentos
+* e decodificacao, caso hajam dois argumentos, apos isso o algoritmo comeca a executar diversas funcoes em que para a codificacao imprime em um arquivo a 
+* tabela, o codigo codificado e o nome original e na decodificacao recupera esses dados e os aplica para gerar um novo arquivo com o nome do arquivo original
+* e com o conteudo original. Os arquivos comprimidos sem ASSINATURA_COMPRIMIDO, gravados por versoes anteriores, sao lidos no formato antigo
+*/
+int main (int argc, char* argv[])
+{
+
+    FILE* arq;
+    Huffman* huffman;
+    char tabela[TOTSIM][MIN];
+    const char* estatisticas = NULL;
+    long long tamanho;
+    zerar_tabela(tabela);
+	int inicio, fim;
+    iniciar_crc32();
+    if (argc>1 && (strcmp(argv[1], "-lote")==0 || strcmp(argv[1], "-arquivar")==0 || strcmp(argv[1], "-fluxo")==0 ||
+                   strcmp(argv[1], "-desfluxo")==0))
+    {
+        estatisticas = separar_estatisticas(&argc, argv);
+    }
+    if ((argc==4 || argc==5) && strcmp(argv[1], "-lote")==0)
+    {
+        return modo_lote(argc, argv, estatisticas);
+    }
+    if (argc>=4 && argc<=6 && strcmp(argv[1], "-arquivar")==0)
+    {
+        return modo_arquivar(argc, argv, estatisticas);
+    }
+    if (argc==3 && strcmp(argv[1], "-listar")==0)
+    {
+        return modo_listar(argv);
+    }
+    if ((argc==4 || argc==5) && strcmp(argv[1], "-extrair")==0)
+    {
+        return modo_extrair(argc, argv);
+    }
+    if (((argc==4 || argc==5) && strcmp(argv[1], "-fluxo")==0) || (argc==4 && strcmp(argv[1], "-desfluxo")==0))
+    {
+        return modo_fluxo(argc, argv, estatisticas);
+    }
+    if (argc>1 && argc<4)
+    {
+        if(argc == 3)
+        {
+			inicio = GetTickCount();
+            huffman = criar_arvore_huffman();
+            tamanho = comprimir_arquivo(huffman, argv[1], argv[2], argv[1]);
+            if (tamanho <= 0)
+            {
+                puts(tamanho == 0 ? "Arquivo nao encontrado!" : "Arquivo com caracteres fora da tabela ASCII ou grande demais!");
+                liberar_arvore_huffman(huffman);
+                return 0;
+            }
+			fim = GetTickCount();
+            printf("Porcentagem de compactacao %.2f\n", (float) (1-(huffman->tamanho_compressao_final/(huffman->caracteres*8)))*100);
+			printf("Tempo computacional: %d\n", fim-inicio);
+            liberar_arvore_huffman(huffman);
         }
         else if(argc == 2)
         {
+            arq = fopen(argv[1],"rb");
             if (arq==NULL)
             {
                 puts("Arquivo nao encontrado!");
                 return 0;
             }
-            int i = 0, j = 0;
-            char caractere, caractere_antigo = 0;
-            int okay = 1;
-            while(!feof(arq))
+            char assinatura[5] = {0};
+            if (fread(assinatura, sizeof(char), 4, arq) == 4 && strcmp(assinatura, ASSINATURA_COMPRIMIDO) == 0)
             {
-                fread(&caractere,sizeof(char),1,arq);
-                if (caractere_antigo == '\n' && caractere == '\n')
-                {
-                    break;
-                }
-                if(caractere == '\n' && okay == 1)
-                {
-                    tabela[i][j] = caractere;
-                    j++;
-                    okay = 0;
-                }
-                else if(caractere == '\n')
-                {
-                    tabela[i][j] = caractere;
-                    i++;
-                    j = 0;
-                }
-                else
+                if (!descomprimir_arquivo(arq))
                 {
-                    tabela[i][j] = caractere;
-                    j++;
+                    puts("Falha na verificacao do arquivo!");
                 }
-                caractere_antigo = caractere;
+                fclose(arq);
+                return 0;
             }
+            rewind(arq);
             char nome_original[50];
             char codificacao[TAM];
-            i=0;
-            while(!feof(arq))
-            {
-                fread(&caractere,sizeof(char),1,arq);
-                if (caractere!='\n')
-                {
-                    nome_original[i] = caractere;
-                }
-                else
-                {
-                    break;
-                }
-                i++;
-            }
-            nome_original[i+1] = 0;
             char total_char[MIN];
-            i= 0;
-            while(!feof(arq))
-            {
-                fread(&caractere,sizeof(char),1,arq);
-                if (caractere!='\n')
-                {
-                    total_char[i] = caractere;
-                }
-                else
-                {
-                    break;
-                }
-                i++;
-            }
-            total_char[i+1] = 0;
+            ler_tabela_codigo(arq, tabela);
+            ler_linha(arq, nome_original, sizeof(nome_original));
+            ler_linha(arq, total_char, sizeof(total_char));
             int total_int = atoi(total_char);
-            gerar_binario(arq, codificacao, total_int);
+            gerar_binario(arq, codificacao, total_int, -1);
             decodificacao(tabela, codificacao, nome_original);
             fclose(arq);
         }
@@ -0,0 +1,62 @@
+@echo off
+rem Comprime e descomprime cada entrada de teste como arquivo unico, como membro de um arquivo de varios membros, com e sem tabela unica,
+rem e em todos os niveis do modo fluxo, comparando cada resultado com o original
+rem Uso: ida_e_volta.bat caminho\ed1.exe
+rem fibonacci.txt tem 20 caracteres, um deles a quebra de linha, com frequencias de Fibonacci, cuja arvore de huffman sem limite tem codigos de 19 bits.
+rem As linhas sao curtas para que o arquivo caiba na matriz de texto dos modos arquivo unico e arquivar
+setlocal
+if "%~1"=="" (set ED1=%CD%\ed1.exe) else (set ED1=%~f1)
+set PASTA=%TEMP%\ida_e_volta
+if not exist "%PASTA%" mkdir "%PASTA%"
+set FALHAS=0
+for %%f in ("%~dp0*.txt") do (
+    call :arquivo "%%~f"
+    call :arquivar "%%~f"
+    call :fluxo "%%~f"
+)
+if %FALHAS% neq 0 (
+    echo %FALHAS% falha^(s^)
+    exit /b 1
+)
+echo Todos os testes passaram
+exit /b 0
+
+:arquivo
+rem A descompressao recria o arquivo com o nome gravado na compressao, por isso a entrada e copiada para a pasta temporaria
+pushd "%PASTA%"
+copy /y "%~1" "%~nx1" >nul
+"%ED1%" "%~nx1" ida_e_volta.huf >nul
+del "%~nx1"
+"%ED1%" ida_e_volta.huf >nul
+fc /b "%~1" "%~nx1" >nul || (
+    echo FALHA: arquivo %~nx1
+    set /a FALHAS+=1
+)
+del "%~nx1" 2>nul
+popd
+exit /b 0
+
+:arquivar
+echo %~1> "%PASTA%\lista.txt"
+for %%t in ("" "-tabela-unica") do (
+    del "%PASTA%\ida_e_volta.mem" 2>nul
+    "%ED1%" -arquivar "%PASTA%\lista.txt" "%PASTA%\ida_e_volta.hfa" 1 %%~t >nul
+    "%ED1%" -extrair "%PASTA%\ida_e_volta.hfa" "%~nx1" "%PASTA%\ida_e_volta.mem" >nul
+    fc /b "%~1" "%PASTA%\ida_e_volta.mem" >nul || (
+        echo FALHA: arquivar %%~t %~nx1
+        set /a FALHAS+=1
+    )
+)
+exit /b 0
+
+:fluxo
+for %%n in (-1 -2 -3) do (
+    del "%PASTA%\ida_e_volta.out" 2>nul
+    "%ED1%" -fluxo %%n "%~1" "%PASTA%\ida_e_volta.hfs" >nul
+    "%ED1%" -desfluxo "%PASTA%\ida_e_volta.hfs" "%PASTA%\ida_e_volta.out" >nul
+    fc /b "%~1" "%PASTA%\ida_e_volta.out" >nul || (
+        echo FALHA: fluxo %%n %~nx1
+        set /a FALHAS+=1
+    )
+)
+exit /b 0